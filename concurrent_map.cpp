@@ -0,0 +1,372 @@
+/*
+sharded concurrent hash map
+- 하나의 mutex로 전체 map을 보호하면 모든 스레드가 그 mutex 하나에서 줄을 선다
+- key의 hash로 shard를 고르고, shard마다 mutex를 둔다. 다른 shard를 쓰는 스레드끼리는 경쟁하지 않는다
+- shard는 cache line 크기로 정렬해서 이웃 shard의 mutex와 false sharing이 생기지 않게 한다
+- shard 안은 linear probing open addressing. node 할당 없이 배열 하나에 원소를 직접 넣는다
+- mutex 타입은 template 인자로 받고, empty_class.cpp의 lock_guard<Mutex>로 잠근다
+- Hash, KeyEqual, Allocator는 compressed_pair로 묶어서, 상태가 없는 policy는 공간을 차지하지 않는다
+- value는 using_compressed_pair::unique_ptr 같은 move-only 타입이어도 된다. try_emplace/extract/erase는 복사 없이 소유권을 옮긴다
+*/
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "compressed_pair.hpp"
+#include "lock_guard.hpp"
+
+template<typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>,
+         typename Mutex = std::mutex, typename Alloc = std::allocator<std::pair<Key, T>>, std::size_t Shards = 64>
+class concurrent_map {
+    static_assert(Shards >= 1 && (Shards & (Shards - 1)) == 0, "Shards must be a power of two");
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Alloc;
+    using mutex_type = Mutex;
+
+private:
+    struct slot {
+        bool full = false;
+        alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+        value_type& get() noexcept { return *std::launder(reinterpret_cast<value_type*>(storage)); }
+    };
+
+    using slot_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<slot>;
+    using slot_traits = std::allocator_traits<slot_allocator>;
+
+    struct alignas(64) shard {
+        Mutex m;
+        slot* slots = nullptr;
+        std::size_t capacity = 0; // 2의 거듭제곱
+        std::size_t size = 0;
+    };
+
+public:
+    concurrent_map() : concurrent_map(Hash(), KeyEqual(), Alloc()) {}
+    // compressed_pair는 인자 2개짜리 생성자가 겹칠 수 있으므로, 항상 one_and_variadic_arg_t로 모든 인자를 넘긴다
+    explicit concurrent_map(const Hash& hash, const KeyEqual& eq = KeyEqual(), const Alloc& alloc = Alloc())
+    : cpair(one_and_variadic_arg_t{}, hash, one_and_variadic_arg_t{}, eq, one_and_variadic_arg_t{}, alloc) {}
+
+    ~concurrent_map() {
+        for (shard& sh : shards()) {
+            destroy(sh.slots, sh.capacity);
+        }
+    }
+
+    concurrent_map(const concurrent_map&) = delete;
+    concurrent_map& operator =(const concurrent_map&) = delete;
+
+    // key가 없을 때만 value를 args로 생성해서 넣는다. 넣었으면 true
+    // key가 이미 있으면 args는 건드리지 않는다(move 되지 않는다)
+    template<typename K, typename ... Args>
+    bool try_emplace(K&& key, Args&& ... args) {
+        std::uint64_t h = hash_of(key);
+        shard& sh = shard_of(h);
+        lock_guard<Mutex> g(sh.m);
+        if (find(sh, key, h)) {
+            return false;
+        }
+        if ((sh.size + 1) * 4 > sh.capacity * 3) {
+            grow(sh);
+        }
+        slot& s = sh.slots[probe_empty(sh, h)];
+        ::new(static_cast<void*>(s.storage)) value_type(std::piecewise_construct,
+                                                        std::forward_as_tuple(std::forward<K>(key)),
+                                                        std::forward_as_tuple(std::forward<Args>(args)...));
+        s.full = true;
+        ++sh.size;
+        return true;
+    }
+
+    // key의 value를 map 밖으로 move 하고 지운다
+    std::optional<T> extract(const Key& key) {
+        std::uint64_t h = hash_of(key);
+        shard& sh = shard_of(h);
+        lock_guard<Mutex> g(sh.m);
+        slot* s = find(sh, key, h);
+        if (!s) {
+            return std::nullopt;
+        }
+        std::optional<T> result(std::move(s->get().second));
+        remove(sh, s);
+        return result;
+    }
+
+    bool erase(const Key& key) {
+        std::uint64_t h = hash_of(key);
+        shard& sh = shard_of(h);
+        lock_guard<Mutex> g(sh.m);
+        slot* s = find(sh, key, h);
+        if (!s) {
+            return false;
+        }
+        remove(sh, s);
+        return true;
+    }
+
+    // value의 참조를 밖으로 넘기면 lock 없이 접근하게 되므로, shard lock을 잡은 채로 f(value)를 호출한다
+    template<typename F>
+    bool visit(const Key& key, F f) {
+        std::uint64_t h = hash_of(key);
+        shard& sh = shard_of(h);
+        lock_guard<Mutex> g(sh.m);
+        slot* s = find(sh, key, h);
+        if (!s) {
+            return false;
+        }
+        f(s->get().second);
+        return true;
+    }
+
+    bool contains(const Key& key) {
+        return visit(key, [](const T&) {});
+    }
+
+    std::size_t size() {
+        std::size_t n = 0;
+        for (shard& sh : shards()) {
+            lock_guard<Mutex> g(sh.m);
+            n += sh.size;
+        }
+        return n;
+    }
+
+    hasher hash_function() const { return cpair.getFirst(); }
+    key_equal key_eq() const { return cpair.getSecond().getFirst(); }
+    allocator_type get_allocator() const { return cpair.getSecond().getSecond().getFirst(); }
+
+private:
+    // std::hash<int>는 항등 함수이므로 그대로 쓰면 상위 bit가 모두 0이다. 섞어서(splitmix64) 모든 bit를 쓴다
+    template<typename K>
+    std::uint64_t hash_of(const K& key) const {
+        std::uint64_t x = cpair.getFirst()(key);
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // 상위 bit로 shard를 고르고, 하위 bit로 shard 안의 칸을 고른다
+    shard& shard_of(std::uint64_t h) noexcept {
+        if constexpr (Shards == 1) {
+            return shards()[0];
+        } else {
+            return shards()[h >> (64 - std::countr_zero(Shards))];
+        }
+    }
+
+    template<typename K>
+    slot* find(shard& sh, const K& key, std::uint64_t h) {
+        if (sh.size == 0) {
+            return nullptr;
+        }
+        std::size_t mask = sh.capacity - 1;
+        for (std::size_t i = h & mask; sh.slots[i].full; i = (i + 1) & mask) {
+            if (cpair.getSecond().getFirst()(sh.slots[i].get().first, key)) {
+                return &sh.slots[i];
+            }
+        }
+        return nullptr;
+    }
+
+    std::size_t probe_empty(shard& sh, std::uint64_t h) noexcept {
+        std::size_t mask = sh.capacity - 1;
+        std::size_t i = h & mask;
+        while (sh.slots[i].full) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    // 칸을 비운 뒤, 뒤에 이어지는 원소 중 비운 칸으로 와야 하는 것을 당겨온다 (backward shift deletion)
+    // tombstone을 남기지 않으므로 erase가 많아도 탐색이 길어지지 않는다
+    void remove(shard& sh, slot* s) {
+        std::size_t mask = sh.capacity - 1;
+        std::size_t hole = static_cast<std::size_t>(s - sh.slots);
+        s->get().~value_type();
+        s->full = false;
+        --sh.size;
+        for (std::size_t j = (hole + 1) & mask; sh.slots[j].full; j = (j + 1) & mask) {
+            std::size_t home = hash_of(sh.slots[j].get().first) & mask;
+            // home이 (hole, j] 구간 밖에 있으면 hole로 옮겨도 탐색에 걸린다
+            bool between = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+            if (!between) {
+                relocate(sh.slots[j], sh.slots[hole]);
+                hole = j;
+            }
+        }
+    }
+
+    void relocate(slot& from, slot& to) {
+        ::new(static_cast<void*>(to.storage)) value_type(std::move(from.get()));
+        to.full = true;
+        from.get().~value_type();
+        from.full = false;
+    }
+
+    void grow(shard& sh) {
+        std::size_t capacity = sh.capacity ? sh.capacity * 2 : 16;
+        slot_allocator alloc(cpair.getSecond().getSecond().getFirst());
+        slot* slots = slot_traits::allocate(alloc, capacity);
+        for (std::size_t i = 0; i < capacity; ++i) {
+            ::new(static_cast<void*>(slots + i)) slot();
+        }
+        std::swap(slots, sh.slots);
+        std::swap(capacity, sh.capacity);
+        for (std::size_t i = 0; i < capacity; ++i) {
+            if (slots[i].full) {
+                relocate(slots[i], sh.slots[probe_empty(sh, hash_of(slots[i].get().first))]);
+            }
+        }
+        destroy(slots, capacity);
+    }
+
+    void destroy(slot* slots, std::size_t capacity) {
+        if (!slots) {
+            return;
+        }
+        for (std::size_t i = 0; i < capacity; ++i) {
+            if (slots[i].full) {
+                slots[i].get().~value_type();
+            }
+        }
+        slot_allocator alloc(cpair.getSecond().getSecond().getFirst());
+        slot_traits::deallocate(alloc, slots, capacity);
+    }
+
+    auto& shards() noexcept { return cpair.getSecond().getSecond().getSecond(); }
+
+    // policy는 empty class인 경우가 많으므로 모두 first에 두고, shard 배열을 가장 안쪽의 second에 둔다
+    // 그래야 Hash, KeyEqual, Alloc이 모두 base class가 되어 공간을 차지하지 않는다 (empty base optimization)
+    compressed_pair<Hash, compressed_pair<KeyEqual, compressed_pair<Alloc, shard[Shards]>>> cpair;
+};
+
+#include <iostream>
+#include "unique_ptr.hpp"
+
+struct Session {
+    int id;
+    explicit Session(int id) : id(id) {}
+};
+
+using session_ptr = using_compressed_pair::unique_ptr<Session, using_compressed_pair::quiet_delete<Session>>;
+
+static void basic() {
+    concurrent_map<int, session_ptr> m;
+    std::cout << std::boolalpha;
+    std::cout << m.try_emplace(1, session_ptr(new Session(100))) << std::endl; // true
+
+    // 이미 있는 key면 넣지 않고, 넘긴 unique_ptr도 그대로 남는다
+    session_ptr p(new Session(200));
+    std::cout << m.try_emplace(1, std::move(p)) << ", " << static_cast<bool>(p) << std::endl; // false, true
+    std::cout << m.try_emplace(2, std::move(p)) << ", " << static_cast<bool>(p) << std::endl; // true, false
+
+    m.visit(1, [](session_ptr& s) { std::cout << s->id << std::endl; }); // 100
+
+    // 소유권을 map 밖으로 꺼낸다
+    std::optional<session_ptr> s = m.extract(2);
+    std::cout << (*s)->id << ", " << m.contains(2) << ", " << m.size() << std::endl; // 200, false, 1
+    std::cout << m.erase(1) << ", " << m.size() << std::endl; // true, 0
+
+    // policy가 모두 empty class 이므로 shard 64개 * 64byte 만큼만 차지한다
+    std::cout << sizeof(m) << std::endl; // 4096
+}
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 벤치마크 비교 대상. std::unordered_map + mutex 하나
+template<typename Key, typename T>
+class locked_map {
+    std::mutex m;
+    std::unordered_map<Key, T> map;
+public:
+    template<typename ... Args>
+    bool try_emplace(const Key& key, Args&& ... args) {
+        lock_guard<std::mutex> g(m);
+        return map.try_emplace(key, std::forward<Args>(args)...).second;
+    }
+    bool erase(const Key& key) {
+        lock_guard<std::mutex> g(m);
+        return map.erase(key) != 0;
+    }
+    bool contains(const Key& key) {
+        lock_guard<std::mutex> g(m);
+        return map.find(key) != map.end();
+    }
+};
+
+// 스레드 1개부터 코어 수만큼 늘리면서 조회 80%, 삽입 10%, 삭제 10%를 섞어서 실행한다
+static void benchmark(std::size_t ops_per_thread = 2'000'000, int key_range = 1 << 16) {
+    using clock = std::chrono::steady_clock;
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto run = [&](const char* name, auto& map, int threads) {
+        for (int k = 0; k < key_range; k += 2) {
+            map.try_emplace(k, session_ptr(new Session(k)));
+        }
+        std::vector<std::thread> workers;
+        auto start = clock::now();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::uint32_t x = 12345 + t;
+                for (std::size_t i = 0; i < ops_per_thread; ++i) {
+                    x = x * 1664525 + 1013904223; // LCG
+                    int key = static_cast<int>(x >> 8) & (key_range - 1);
+                    unsigned op = x % 10;
+                    if (op < 8) {
+                        map.contains(key);
+                    } else if (op == 8) {
+                        map.try_emplace(key, session_ptr(new Session(key)));
+                    } else {
+                        map.erase(key);
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        double sec = std::chrono::duration<double>(clock::now() - start).count();
+        std::cout << name << " threads " << threads << ": " << static_cast<long long>(ops_per_thread * threads / sec) << " ops/s" << std::endl;
+    };
+
+    std::vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    for (int threads : thread_counts) {
+        {
+            concurrent_map<int, session_ptr> m;
+            run("concurrent_map", m, threads);
+        }
+        {
+            locked_map<int, session_ptr> m;
+            run("unordered_map + mutex", m, threads);
+        }
+    }
+}
+
+void sharded_map() {
+    basic();
+    benchmark();
+}
@@ -101,37 +101,8 @@ static void empty_class2() {
 
 #include <mutex>
 
-// empty struct
-struct adopt_lock_t {
-    explicit adopt_lock_t() = default; // lock_guard g(m, {}); 이렇게 쓰는 것을 막기 위해
-};
-constexpr adopt_lock_t adopt_lock; // constexpr을 써서 compile time에 확인하자
-
-// RAII(Resource Acquisition Is Initialization)
-template <class Mutex>
-class lock_guard {
-public:
-    using mutex_type = Mutex;
-    // compile time이 아닌, run time에 autolock 조건이 체크됨. 초큼 구림
-    explicit lock_guard(Mutex& mtx, bool autolock=true) : mtx(mtx) {
-        if (autolock) {
-            mtx.lock();
-        }
-    }
-    // 그래서 empty struct를 인자로 받고, mtx.lock();을 하지 않는 생성자를 만듬
-    // compile time에 autolock 조건을 체크할 수 있으며, 이런 트릭을 tag dispatching 이라고 함
-    // empty struct를 사용하지 않고, 그냥 int와 같은 type을 적어도 되지만
-    // int라는 type만으로 autolock의 의미를 나타내긴 어려우므로
-    // 의미를 나타내는 adopt_lock_t라는 type(그래서 tag type이라고 부름)을 정의하는 것이 가독성면에서 좋다
-    explicit lock_guard(Mutex& mtx, adopt_lock_t) : mtx(mtx) {
-    }
-    ~lock_guard() noexcept {mtx.unlock();}
-
-    lock_guard(const lock_guard&) = delete; // 복사 금지
-    lock_guard& operator =(const lock_guard&) = delete; // 대입 금지
-private:
-    Mutex& mtx;
-};
+// adopt_lock_t, lock_guard는 다른 파일에서도 쓰기 위해 lock_guard.hpp로 옮겼다
+#include "lock_guard.hpp"
 
 static void tag_dispatching() {
     {
@@ -0,0 +1,325 @@
+/*
+fused pipeline
+- exam3()처럼 reverse_view 위에 drop_view를 쌓으면 iterator가 iterator를 감싼다
+- 단계마다 분기와 간접 참조가 하나씩 늘어나고, filter_view는 begin()을 캐시하는 등 컴파일러가 loop를 vectorize 하기 어렵다
+- fused::view(v) | ... 로 만든 pipeline은 단계를 쌓을 때마다 compile time에 알려진 조합을 다시 써서(rewrite) 하나의 평평한 loop로 만든다
+  - reverse, drop: 원소를 1:1로 바꾸는 transform과는 순서를 바꿔도 같으므로, 포인터 구간 [first, last)와 방향(Reversed)만 바꾼다
+    drop∘reverse -> 뒤에서부터 도는 subrange
+    reverse∘reverse -> 원래 방향
+  - transform∘transform -> 두 함수를 합친 transform 하나
+  - filter∘filter -> 두 조건을 && 한 filter 하나
+  - filter∘transform -> 원소마다 f 호출 후 p 검사를 하는 kernel 하나
+  - filter 뒤의 drop은 구간으로 바꿀 수 없으므로 kernel 안의 counter가 된다
+- 마지막에 for_each / sum / to_vector로 실행한다 (push 방식)
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fused {
+    // kernel은 원소 하나를 받아서 다음 단계(sink)로 0개 또는 1개를 넘긴다
+    // output<In>: 원소 타입이 In일 때 kernel을 통과해서 나오는 값의 타입
+    struct identity_kernel {
+        template<typename In> using output = In;
+
+        template<typename T, typename Sink>
+        void operator ()(T&& x, Sink&& sink) { sink(std::forward<T>(x)); }
+    };
+
+    template<typename Prev, typename F>
+    struct transform_kernel {
+        Prev prev;
+        F f;
+
+        template<typename In>
+        using output = std::remove_cvref_t<std::invoke_result_t<F&, typename Prev::template output<In>&>>;
+
+        template<typename T, typename Sink>
+        void operator ()(T&& x, Sink&& sink) {
+            prev(std::forward<T>(x), [&](auto&& y) { sink(std::invoke(f, std::forward<decltype(y)>(y))); });
+        }
+    };
+
+    template<typename Prev, typename P>
+    struct filter_kernel {
+        Prev prev;
+        P pred;
+
+        template<typename In> using output = typename Prev::template output<In>;
+
+        template<typename T, typename Sink>
+        void operator ()(T&& x, Sink&& sink) {
+            prev(std::forward<T>(x), [&](auto&& y) {
+                if (std::invoke(pred, y)) sink(std::forward<decltype(y)>(y));
+            });
+        }
+    };
+
+    // filter 뒤의 drop. 통과한 원소 중 처음 n개를 버린다
+    template<typename Prev>
+    struct drop_kernel {
+        Prev prev;
+        std::size_t n;
+
+        template<typename In> using output = typename Prev::template output<In>;
+
+        template<typename T, typename Sink>
+        void operator ()(T&& x, Sink&& sink) {
+            prev(std::forward<T>(x), [&](auto&& y) {
+                if (n) --n;
+                else sink(std::forward<decltype(y)>(y));
+            });
+        }
+    };
+
+    // 원소 개수와 순서를 바꾸지 않는 kernel인지. 이런 kernel 뒤의 reverse/drop은 구간 연산으로 바꿀 수 있다
+    template<typename K> struct is_one_to_one : std::false_type {};
+    template<> struct is_one_to_one<identity_kernel> : std::true_type {};
+    template<typename Prev, typename F> struct is_one_to_one<transform_kernel<Prev, F>> : is_one_to_one<Prev> {};
+
+    template<typename F, typename G>
+    struct composed {
+        F f;
+        G g;
+        template<typename T>
+        decltype(auto) operator ()(T&& x) { return std::invoke(g, std::invoke(f, std::forward<T>(x))); }
+    };
+
+    template<typename P, typename Q>
+    struct both {
+        P p;
+        Q q;
+        template<typename T>
+        bool operator ()(const T& x) { return std::invoke(p, x) && std::invoke(q, x); }
+    };
+
+    // transform을 붙인다. 이미 transform으로 끝나면 함수를 합친다
+    template<typename K, typename G>
+    auto add_transform(K k, G g) { return transform_kernel<K, G>{std::move(k), std::move(g)}; }
+    template<typename Prev, typename F, typename G>
+    auto add_transform(transform_kernel<Prev, F> k, G g) {
+        return transform_kernel<Prev, composed<F, G>>{std::move(k.prev), {std::move(k.f), std::move(g)}};
+    }
+
+    // filter를 붙인다. 이미 filter로 끝나면 조건을 합친다
+    template<typename K, typename Q>
+    auto add_filter(K k, Q q) { return filter_kernel<K, Q>{std::move(k), std::move(q)}; }
+    template<typename Prev, typename P, typename Q>
+    auto add_filter(filter_kernel<Prev, P> k, Q q) {
+        return filter_kernel<Prev, both<P, Q>>{std::move(k.prev), {std::move(k.pred), std::move(q)}};
+    }
+
+    // drop을 kernel에 붙인다. 이미 drop으로 끝나면 개수를 더한다
+    template<typename K>
+    auto add_drop(K k, std::size_t n) { return drop_kernel<K>{std::move(k), n}; }
+    template<typename Prev>
+    auto add_drop(drop_kernel<Prev> k, std::size_t n) { return drop_kernel<Prev>{std::move(k.prev), k.n + n}; }
+
+    // 연속된 메모리 [first, last)를 Reversed 방향으로 돌면서 kernel을 적용하는 view
+    template<typename T, bool Reversed, typename Kernel>
+    class pipeline {
+    public:
+        using value_type = typename Kernel::template output<std::remove_cv_t<T>>;
+        static constexpr bool reversed = Reversed;
+
+        pipeline(T* first, T* last, Kernel kernel) : first(first), last(last), kernel(std::move(kernel)) {}
+
+        // loop가 하나뿐이므로 원소마다 분기는 kernel 안의 filter 조건뿐이다
+        // kernel의 drop counter가 실행마다 처음부터 시작하도록 복사해서 쓴다
+        template<typename F>
+        void for_each(F f) const {
+            Kernel k = kernel;
+            if constexpr (Reversed) {
+                for (T* p = last; p != first;) {
+                    k(*--p, f);
+                }
+            } else {
+                for (T* p = first; p != last; ++p) {
+                    k(*p, f);
+                }
+            }
+        }
+
+        auto sum() const {
+            value_type total{};
+            for_each([&](auto&& x) { total += x; });
+            return total;
+        }
+
+        std::vector<value_type> to_vector() const {
+            std::vector<value_type> v;
+            for_each([&](auto&& x) { v.push_back(std::forward<decltype(x)>(x)); });
+            return v;
+        }
+
+        T* first;
+        T* last;
+        Kernel kernel;
+    };
+
+    // 시작점. 연속된 메모리를 갖는 range만 받는다 (std::vector, unique_array, std::span ...)
+    template<std::ranges::contiguous_range R>
+    auto view(R& r) {
+        using T = std::remove_reference_t<std::ranges::range_reference_t<R>>;
+        T* first = std::ranges::data(r);
+        return pipeline<T, false, identity_kernel>(first, first + std::ranges::size(r), identity_kernel{});
+    }
+
+    // adaptor. exam3()의 drop_view 처럼 값만 들고 있다가 | 연산자에서 pipeline을 다시 만든다
+    struct reverse_t {};
+    constexpr reverse_t reverse;
+
+    struct drop_t {
+        std::size_t n;
+    };
+    inline drop_t drop(std::size_t n) { return drop_t{n}; }
+
+    template<typename F>
+    struct transform_t {
+        F f;
+    };
+    template<typename F>
+    transform_t<F> transform(F f) { return {std::move(f)}; }
+
+    template<typename P>
+    struct filter_t {
+        P pred;
+    };
+    template<typename P>
+    filter_t<P> filter(P pred) { return {std::move(pred)}; }
+
+    // reverse: 1:1 kernel 뒤라면 방향만 바꾼다. reverse∘reverse는 원래 방향이 된다
+    template<typename T, bool R, typename K>
+    auto operator |(pipeline<T, R, K> p, reverse_t) {
+        static_assert(is_one_to_one<K>::value, "reverse after filter/drop needs buffering; it cannot be fused");
+        return pipeline<T, !R, K>(p.first, p.last, std::move(p.kernel));
+    }
+
+    // drop: 1:1 kernel 뒤라면 구간을 줄인다. 뒤집힌 방향이면 뒤쪽을 줄인다 (drop∘reverse -> 뒤집힌 subrange)
+    template<typename T, bool R, typename K>
+    auto operator |(pipeline<T, R, K> p, drop_t d) {
+        if constexpr (is_one_to_one<K>::value) {
+            std::size_t n = std::min<std::size_t>(d.n, p.last - p.first);
+            if constexpr (R) p.last -= n;
+            else p.first += n;
+            return p;
+        } else {
+            auto k = add_drop(std::move(p.kernel), d.n);
+            return pipeline<T, R, decltype(k)>(p.first, p.last, std::move(k));
+        }
+    }
+
+    template<typename T, bool R, typename K, typename F>
+    auto operator |(pipeline<T, R, K> p, transform_t<F> t) {
+        auto k = add_transform(std::move(p.kernel), std::move(t.f));
+        return pipeline<T, R, decltype(k)>(p.first, p.last, std::move(k));
+    }
+
+    template<typename T, bool R, typename K, typename P>
+    auto operator |(pipeline<T, R, K> p, filter_t<P> f) {
+        auto k = add_filter(std::move(p.kernel), std::move(f.pred));
+        return pipeline<T, R, decltype(k)>(p.first, p.last, std::move(k));
+    }
+}
+
+#include <iostream>
+
+static void basic() {
+    std::vector v = {1,2,3,4,5,6,7,8,9,10};
+
+    // exam3()과 같은 reverse + drop. 중첩된 view가 아니라 뒤집힌 subrange 하나가 된다
+    auto p1 = fused::view(v) | fused::reverse | fused::drop(3);
+    static_assert(decltype(p1)::reversed);
+    static_assert(std::is_same_v<decltype(p1.kernel), fused::identity_kernel>);
+    p1.for_each([](int e) { std::cout << e << ", "; }); // 7, 6, 5, 4, 3, 2, 1,
+    std::cout << std::endl;
+
+    // transform 두개는 하나로, filter 두개는 하나로 합쳐진다
+    auto p2 = fused::view(v)
+            | fused::transform([](int x) { return x * 3; })
+            | fused::transform([](int x) { return x + 1; })
+            | fused::filter([](int x) { return x % 2 == 0; })
+            | fused::filter([](int x) { return x > 10; });
+    using kernel2 = decltype(p2.kernel);
+    static_assert(std::is_same_v<decltype(kernel2::prev.prev), fused::identity_kernel>); // transform 1개 + filter 1개
+    for (int e : p2.to_vector()) {
+        std::cout << e << ", "; // 16, 22, 28,
+    }
+    std::cout << std::endl;
+
+    // transform은 1:1 이므로 뒤에 오는 reverse/drop도 구간 연산이 된다
+    auto p3 = fused::view(v) | fused::transform([](int x) { return x * x; }) | fused::reverse | fused::drop(2) | fused::reverse;
+    std::cout << p3.sum() << std::endl; // 1+4+...+64 = 204
+
+    // filter 뒤의 drop은 kernel 안의 counter가 된다
+    auto p4 = fused::view(v) | fused::filter([](int x) { return x % 2; }) | fused::drop(2);
+    std::cout << p4.sum() << std::endl; // 5+7+9 = 21
+    // fused::view(v) | fused::filter(...) | fused::reverse; // error. 버퍼 없이는 합칠 수 없다
+}
+
+#include <chrono>
+#include <numeric>
+
+// 1억개의 int에 3 ~ 5단계 pipeline을 적용해서 합을 구한다. std::views를 중첩한 것과 시간을 비교하고, 두 합이 같은지 확인한다
+static void benchmark(std::size_t n = 100'000'000) {
+    using clock = std::chrono::steady_clock;
+    std::vector<int> v(n);
+    std::iota(v.begin(), v.end(), 0);
+
+    auto measure = [](const char* name, auto f) {
+        auto start = clock::now();
+        long long result = f();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start).count();
+        std::cout << name << ": " << elapsed << "ms (" << result << ")" << std::endl;
+        return result;
+    };
+    auto check = [](const char* name, long long nested_result, long long fused_result) {
+        if (nested_result != fused_result) {
+            std::cout << name << ": MISMATCH nested " << nested_result << " != fused " << fused_result << std::endl;
+        }
+    };
+    auto nested_sum = [](auto&& r) {
+        long long total = 0;
+        for (auto e : r) total += e;
+        return total;
+    };
+
+    auto triple = [](int x) { return static_cast<long long>(x) * 3; };
+    auto plus1 = [](long long x) { return x + 1; };
+    auto even = [](long long x) { return x % 2 == 0; };
+
+    long long nested_result, fused_result;
+
+    // 3단계: reverse, drop, transform
+    nested_result = measure("3 stages nested", [&] { return nested_sum(v | std::views::reverse | std::views::drop(3) | std::views::transform(triple)); });
+    fused_result = measure("3 stages fused ", [&] { return (fused::view(v) | fused::reverse | fused::drop(3) | fused::transform(triple)).sum(); });
+    check("3 stages", nested_result, fused_result);
+
+    // 4단계: drop, reverse, transform, filter
+    nested_result = measure("4 stages nested", [&] {
+        return nested_sum(v | std::views::drop(10) | std::views::reverse | std::views::transform(triple) | std::views::filter(even));
+    });
+    fused_result = measure("4 stages fused ", [&] {
+        return (fused::view(v) | fused::drop(10) | fused::reverse | fused::transform(triple) | fused::filter(even)).sum();
+    });
+    check("4 stages", nested_result, fused_result);
+
+    // 5단계: reverse, drop, transform, transform, filter
+    nested_result = measure("5 stages nested", [&] {
+        return nested_sum(v | std::views::reverse | std::views::drop(5) | std::views::transform(triple) | std::views::transform(plus1) | std::views::filter(even));
+    });
+    fused_result = measure("5 stages fused ", [&] {
+        return (fused::view(v) | fused::reverse | fused::drop(5) | fused::transform(triple) | fused::transform(plus1) | fused::filter(even)).sum();
+    });
+    check("5 stages", nested_result, fused_result);
+}
+
+void fused_pipeline() {
+    basic();
+    benchmark();
+}
@@ -0,0 +1,279 @@
+/*
+inline_ptr
+- unique_ptr<Base>는 Derived 객체를 항상 heap에 둔다. 객체 하나마다 할당 1번 + 포인터 역참조 1번
+- inline_ptr<Base, N>은 N byte 이하의 Derived 객체를 handle 내부 버퍼에 직접 생성한다 (small buffer optimization)
+- N byte보다 크거나, move 생성자가 noexcept가 아닌 타입은 heap에 생성한다
+- unique_ptr와 같이 복사는 금지, move만 지원하고, coercion by member template으로 inline_ptr<Dog> -> inline_ptr<Animal> 변환을 지원한다
+*/
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 타입을 지운(type erasure) 상태에서 객체를 소멸/이동하기 위한 함수 테이블
+// Derived 타입마다 하나씩 static 으로 만들어지므로 handle에는 포인터 하나만 들어간다
+struct inline_ptr_ops {
+    std::size_t size;
+    std::size_t align;
+    bool nothrow_move;
+    void (*destroy)(void* obj) noexcept;
+    void (*move_construct)(void* dst, void* src) noexcept;
+
+    template<typename D>
+    static const inline_ptr_ops* get() noexcept {
+        static constexpr inline_ptr_ops ops{
+            sizeof(D), alignof(D), std::is_nothrow_move_constructible_v<D>,
+            [](void* obj) noexcept { static_cast<D*>(obj)->~D(); },
+            // nothrow_move가 false인 타입은 항상 heap에 있으므로 이 함수가 호출되지 않는다
+            [](void* dst, void* src) noexcept { ::new(dst) D(std::move(*static_cast<D*>(src))); },
+        };
+        return &ops;
+    }
+};
+
+template<typename Base, std::size_t N = 3 * sizeof(void*), std::size_t Align = alignof(std::max_align_t)>
+class inline_ptr {
+    template<typename U, std::size_t M, std::size_t A> friend class inline_ptr;
+public:
+    using pointer = Base*;
+    using element_type = Base;
+
+    inline_ptr() noexcept = default;
+    inline_ptr(std::nullptr_t) noexcept {}
+
+    // 어떤 Derived 타입을 만들지 지정해야 하므로 std::in_place_type 으로 tag dispatching 한다
+    template<typename D, typename ... Args>
+    explicit inline_ptr(std::in_place_type_t<D>, Args&& ... args) {
+        static_assert(std::is_convertible_v<D*, Base*>, "D must derive from Base");
+        if constexpr (fits<D>()) {
+            obj = ::new(static_cast<void*>(buf)) D(std::forward<Args>(args)...);
+        } else {
+            void* mem = ::operator new(sizeof(D), std::align_val_t{alignof(D)});
+            try {
+                obj = ::new(mem) D(std::forward<Args>(args)...);
+            } catch (...) {
+                ::operator delete(mem, std::align_val_t{alignof(D)});
+                throw;
+            }
+        }
+        ops = inline_ptr_ops::get<D>();
+        ptr = static_cast<D*>(obj);
+    }
+
+    ~inline_ptr() { reset(); }
+
+    // 복사 생성자는 금지시키고
+    inline_ptr(const inline_ptr&) = delete;
+    inline_ptr& operator =(const inline_ptr&) = delete;
+
+    // move는 지원한다. template 생성자는 move 생성자로 취급되지 않으므로 따로 만든다
+    inline_ptr(inline_ptr&& ip) noexcept { take(ip); }
+
+    // coercion by member template. inline_ptr<Dog, M> -> inline_ptr<Animal, N>
+    // intrusive_ptr와 같이 변환 가능한 타입만 overload 후보가 되도록 requires로 제한한다
+    template<typename U, std::size_t M, std::size_t A>
+    requires std::is_convertible_v<U*, Base*>
+    inline_ptr(inline_ptr<U, M, A>&& ip) noexcept(M <= N && A <= Align) {
+        take(ip);
+    }
+
+    inline_ptr& operator =(inline_ptr&& ip) noexcept {
+        if (this != std::addressof(ip)) {
+            reset();
+            take(ip);
+        }
+        return *this;
+    }
+
+    template<typename U, std::size_t M, std::size_t A>
+    requires std::is_convertible_v<U*, Base*>
+    inline_ptr& operator =(inline_ptr<U, M, A>&& ip) {
+        reset();
+        take(ip);
+        return *this;
+    }
+
+    Base& operator *() const { return *ptr; }
+    pointer operator ->() const { return ptr; }
+    pointer get() const noexcept { return ptr; }
+    explicit operator bool() const noexcept { return ptr != nullptr; }
+
+    // 객체가 handle 내부 버퍼에 있는지 여부
+    bool is_inline() const noexcept { return obj == static_cast<const void*>(buf); }
+
+    void reset() noexcept {
+        if (!ptr) {
+            return;
+        }
+        ops->destroy(obj);
+        if (!is_inline()) {
+            ::operator delete(obj, std::align_val_t{ops->align});
+        }
+        obj = nullptr;
+        ptr = nullptr;
+        ops = nullptr;
+    }
+
+private:
+    template<typename D>
+    static constexpr bool fits() noexcept {
+        return sizeof(D) <= N && alignof(D) <= Align && std::is_nothrow_move_constructible_v<D>;
+    }
+
+    bool fits(const inline_ptr_ops* o) const noexcept {
+        return o->size <= N && o->align <= Align && o->nothrow_move;
+    }
+
+    // 다른 handle의 객체를 가져온다
+    // heap에 있으면 포인터만 훔치고, 내부 버퍼에 있으면 이쪽 버퍼(또는 heap)로 move 생성한다
+    // Base*는 완전한 객체 주소로부터의 offset이 타입마다 고정되어 있으므로 offset을 유지해서 다시 계산한다
+    template<typename U, std::size_t M, std::size_t A>
+    void take(inline_ptr<U, M, A>& ip) {
+        if (!ip.ptr) {
+            return;
+        }
+        Base* converted = ip.ptr;
+        std::ptrdiff_t offset = reinterpret_cast<char*>(converted) - static_cast<char*>(ip.obj);
+        if (!ip.is_inline()) {
+            obj = std::exchange(ip.obj, nullptr);
+        } else {
+            void* dst = fits(ip.ops) ? static_cast<void*>(buf) : ::operator new(ip.ops->size, std::align_val_t{ip.ops->align});
+            ip.ops->move_construct(dst, ip.obj);
+            ip.ops->destroy(ip.obj);
+            ip.obj = nullptr;
+            obj = dst;
+        }
+        ptr = reinterpret_cast<Base*>(static_cast<char*>(obj) + offset);
+        ops = std::exchange(ip.ops, nullptr);
+        ip.ptr = nullptr;
+    }
+
+    alignas(Align) unsigned char buf[N];
+    void* obj = nullptr; // 완전한 객체(most derived object)의 주소
+    Base* ptr = nullptr;
+    const inline_ptr_ops* ops = nullptr;
+};
+
+// make_unique 처럼 사용하기 위한 helper
+template<typename Base, typename D, std::size_t N = 3 * sizeof(void*), typename ... Args>
+inline_ptr<Base, N> make_inline(Args&& ... args) {
+    return inline_ptr<Base, N>(std::in_place_type<D>, std::forward<Args>(args)...);
+}
+
+struct Shape {
+    virtual ~Shape() = default;
+    virtual double area() const = 0;
+};
+
+struct Circle : Shape {
+    double r;
+    explicit Circle(double r) : r(r) {}
+    double area() const override { return 3.14159 * r * r; }
+};
+
+struct Rect : Shape {
+    double w, h;
+    Rect(double w, double h) : w(w), h(h) {}
+    double area() const override { return w * h; }
+};
+
+struct Polygon : Shape {
+    double xs[16]{};
+    double area() const override { return xs[0]; }
+};
+
+static void basic() {
+    inline_ptr<Shape> p1(std::in_place_type<Circle>, 1.0); // 내부 버퍼
+    inline_ptr<Shape> p2(std::in_place_type<Polygon>); // 128byte 이므로 heap
+    auto p3 = make_inline<Shape, Rect>(2.0, 3.0);
+
+    std::cout << std::boolalpha;
+    std::cout << p1->area() << ", " << p1.is_inline() << std::endl; // 3.14159, true
+    std::cout << p2->area() << ", " << p2.is_inline() << std::endl; // 0, false
+    std::cout << p3->area() << ", " << p3.is_inline() << std::endl; // 6, true
+
+    // inline_ptr<Shape> p4 = p1; // error. 복사 금지
+    inline_ptr<Shape> p5 = std::move(p1);
+    std::cout << static_cast<bool>(p1) << ", " << p5->area() << std::endl; // false, 3.14159
+
+    // 버퍼(24byte) + obj, ptr, ops 포인터 3개 = 48byte
+    std::cout << sizeof(inline_ptr<Shape>) << std::endl;
+}
+
+static void coercion() {
+    // making_unique_ptr4() 와 같이 Derived -> Base 변환
+    inline_ptr<Rect> r(std::in_place_type<Rect>, 2.0, 2.0);
+    inline_ptr<Shape> s = std::move(r);
+    std::cout << s->area() << ", " << s.is_inline() << std::endl; // 4, true
+
+    // 버퍼가 작은 쪽으로 옮기면 heap으로 옮겨진다
+    inline_ptr<Shape, 64> big(std::in_place_type<Rect>, 3.0, 3.0);
+    inline_ptr<Shape, 8> small = std::move(big);
+    std::cout << small->area() << ", " << small.is_inline() << std::endl; // 9, false
+    // 관계 없는 타입에서는 변환 생성자가 후보에서 빠진다
+    static_assert(std::is_constructible_v<inline_ptr<Shape>, inline_ptr<Rect>&&>);
+    static_assert(!std::is_constructible_v<inline_ptr<Shape>, inline_ptr<int>&&>);
+    static_assert(!std::is_assignable_v<inline_ptr<Shape>&, inline_ptr<int>&&>);
+}
+
+#include <chrono>
+#include <vector>
+
+// 1000만개의 다형적 객체를 만들고 순회하는 시간을 비교
+static void benchmark(std::size_t n = 10'000'000) {
+    using clock = std::chrono::steady_clock;
+    auto ms = [](auto d) { return std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+
+    {
+        auto start = clock::now();
+        std::vector<std::unique_ptr<Shape>> v;
+        v.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i % 2) v.push_back(std::make_unique<Circle>(1.0));
+            else v.push_back(std::make_unique<Rect>(1.0, 2.0));
+        }
+        auto built = clock::now();
+        double sum = 0;
+        for (auto& p : v) sum += p->area();
+        auto end = clock::now();
+        std::cout << "unique_ptr build: " << ms(built - start) << "ms, iterate: " << ms(end - built) << "ms (" << sum << ")" << std::endl;
+    }
+    {
+        auto start = clock::now();
+        std::vector<inline_ptr<Shape>> v;
+        v.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i % 2) v.emplace_back(std::in_place_type<Circle>, 1.0);
+            else v.emplace_back(std::in_place_type<Rect>, 1.0, 2.0);
+        }
+        auto built = clock::now();
+        double sum = 0;
+        for (auto& p : v) sum += p->area();
+        auto end = clock::now();
+        std::cout << "inline_ptr build: " << ms(built - start) << "ms, iterate: " << ms(end - built) << "ms (" << sum << ")" << std::endl;
+    }
+    {
+        // 버퍼가 작아서 전부 heap으로 가는 경우
+        auto start = clock::now();
+        std::vector<inline_ptr<Shape, 8>> v;
+        v.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (i % 2) v.emplace_back(std::in_place_type<Circle>, 1.0);
+            else v.emplace_back(std::in_place_type<Rect>, 1.0, 2.0);
+        }
+        auto built = clock::now();
+        double sum = 0;
+        for (auto& p : v) sum += p->area();
+        auto end = clock::now();
+        std::cout << "inline_ptr(heap) build: " << ms(built - start) << "ms, iterate: " << ms(end - built) << "ms (" << sum << ")" << std::endl;
+    }
+}
+
+void making_inline_ptr() {
+    basic();
+    coercion();
+    benchmark();
+}
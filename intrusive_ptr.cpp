@@ -0,0 +1,141 @@
+/*
+intrusive_ptr
+- Label은 참조 카운트를 new int(1)로 따로 할당한다. 객체마다 할당이 하나 더 생기고, 카운트를 바꿀 때마다 다른 cache line을 건드린다
+- ref_counted<T, Policy>를 상속하면 참조 카운트가 객체 안에 들어간다 (CRTP)
+- Policy는 compile time에 고른다. single_thread_count(int), atomic_count(std::atomic<int>)
+- Policy는 empty class 이므로 compressed_pair(EBCO)로 공간을 차지하지 않는다
+*/
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include "intrusive_ptr.hpp"
+
+namespace intrusive {
+    // Label의 text + ref를 하나로 합친 버퍼
+    struct label_text : public ref_counted<label_text> {
+        std::string text;
+        explicit label_text(const char* s) : text(s) {}
+        ~label_text() { std::cout << "deleted " << text << std::endl; }
+    };
+
+    class Label {
+        intrusive_ptr<label_text> buf;
+    public:
+        Label(const char* s) : buf(make_intrusive<label_text>(s)) {}
+
+        // 복사 생성자, 소멸자는 intrusive_ptr가 참조 카운트를 관리하므로 default로 충분하다
+
+        // 쓰기 전에 공유 중이면 떼어낸다(copy on write)
+        void set(std::size_t idx, char value) {
+            if (buf->use_count() > 1) {
+                buf = make_intrusive<label_text>(buf->text.c_str());
+            }
+            buf->text[idx] = value;
+        }
+        char operator [](std::size_t idx) const { return buf->text[idx]; }
+
+        void print() const {
+            std::cout << buf->text << " ref: " << buf->use_count() << std::endl;
+        }
+    };
+}
+
+static void basic() {
+    intrusive::Label lb1("hello");
+    intrusive::Label lb2 = lb1;
+    lb1.print(); // hello ref: 2
+    lb1.set(0, 'A');
+    lb1.print(); // Aello ref: 1
+    lb2.print(); // hello ref: 1
+}
+
+struct Node1 : public ref_counted<Node1, single_thread_count> {
+    int value = 0;
+};
+
+struct Node2 : public ref_counted<Node2, atomic_count> {
+    int value = 0;
+};
+
+static void policy() {
+    // policy가 empty class 이므로 카운트(int) 크기만 늘어난다
+    std::cout << sizeof(single_thread_count) << ", " << sizeof(atomic_count) << std::endl; // 1, 1
+    std::cout << sizeof(Node1) << ", " << sizeof(Node2) << std::endl; // 8, 8
+
+    intrusive_ptr<Node2> p1 = make_intrusive<Node2>();
+    intrusive_ptr<Node2> p2 = p1;
+    std::cout << p1->use_count() << std::endl; // 2
+    // 객체 안에 카운트가 있으므로 raw pointer로부터 다시 intrusive_ptr를 만들어도 안전하다
+    intrusive_ptr<Node2> p3(p2.get());
+    std::cout << p1->use_count() << std::endl; // 3
+}
+
+#include <chrono>
+#include <vector>
+
+// Label 처럼 카운트를 따로 할당하는 handle
+template<typename T>
+class separate_count_ptr {
+    T* p = nullptr;
+    int* ref = nullptr;
+public:
+    separate_count_ptr() = default;
+    explicit separate_count_ptr(T* p) : p(p), ref(new int(1)) {}
+    separate_count_ptr(const separate_count_ptr& o) : p(o.p), ref(o.ref) { if (ref) ++*ref; }
+    separate_count_ptr& operator =(const separate_count_ptr&) = delete;
+    ~separate_count_ptr() {
+        if (ref && --*ref == 0) {
+            delete ref;
+            delete p;
+        }
+    }
+    T* operator ->() const { return p; }
+};
+
+struct Payload {
+    int value = 1;
+};
+
+struct Payload1 : public ref_counted<Payload1, single_thread_count> {
+    int value = 1;
+};
+
+struct Payload2 : public ref_counted<Payload2, atomic_count> {
+    int value = 1;
+};
+
+// n개의 객체를 만들고, handle 전체를 rounds번 복사/소멸시켜서 참조 카운트 증감 비용을 측정
+static void benchmark(std::size_t n = 1'000'000, int rounds = 20) {
+    using clock = std::chrono::steady_clock;
+    auto run = [&](const char* name, auto make) {
+        auto start = clock::now();
+        std::vector<decltype(make())> v;
+        v.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            v.push_back(make());
+        }
+        auto built = clock::now();
+        long long sum = 0;
+        for (int r = 0; r < rounds; ++r) {
+            std::vector<decltype(make())> copy(v); // 증가
+            sum += copy[r]->value;
+        } // 감소
+        auto end = clock::now();
+        std::cout << name << " build: " << std::chrono::duration_cast<std::chrono::milliseconds>(built - start).count()
+                  << "ms, copy/destroy: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - built).count()
+                  << "ms (" << sum << ")" << std::endl;
+    };
+
+    run("separate count", [] { return separate_count_ptr<Payload>(new Payload); });
+    run("intrusive single_thread_count", [] { return make_intrusive<Payload1>(); });
+    run("intrusive atomic_count", [] { return make_intrusive<Payload2>(); });
+    run("std::shared_ptr(new)", [] { return std::shared_ptr<Payload>(new Payload); });
+    run("std::make_shared", [] { return std::make_shared<Payload>(); });
+}
+
+void making_intrusive_ptr() {
+    basic();
+    policy();
+    benchmark();
+}
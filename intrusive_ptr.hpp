@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "compressed_pair.hpp"
+
+// 참조 카운트를 어떻게 증가/감소 시킬지 결정하는 policy
+// 멤버 데이터가 없는 empty class 이므로 compressed_pair에 넣으면 공간을 차지하지 않는다
+
+// 싱글 스레드 전용. 그냥 int
+struct single_thread_count {
+    using count_type = int;
+    void increment(count_type& c) const noexcept { ++c; }
+    // 마지막 참조가 사라졌으면 true
+    bool decrement(count_type& c) const noexcept { return --c == 0; }
+    // 0이 아닐 때만 증가. 이미 소멸 중인 객체를 다시 살리지 않기 위해 사용한다
+    bool try_increment(count_type& c) const noexcept { return c != 0 && ++c; }
+    int load(const count_type& c) const noexcept { return c; }
+};
+
+// 멀티 스레드. 증가는 다른 메모리 연산과 순서를 맞출 필요가 없으므로 relaxed
+// 감소는 이전 스레드들의 쓰기가 delete 하는 스레드에게 보여야 하므로 acq_rel
+struct atomic_count {
+    using count_type = std::atomic<int>;
+    void increment(count_type& c) const noexcept { c.fetch_add(1, std::memory_order_relaxed); }
+    bool decrement(count_type& c) const noexcept { return c.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    bool try_increment(count_type& c) const noexcept {
+        int n = c.load(std::memory_order_relaxed);
+        while (n != 0) {
+            if (c.compare_exchange_weak(n, n + 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    int load(const count_type& c) const noexcept { return c.load(std::memory_order_relaxed); }
+};
+
+// CRTP base. 참조 카운트를 객체 안에 넣는다 (Label 처럼 new int(1)을 따로 할당하지 않는다)
+// class Text : public ref_counted<Text> { ... };
+template<typename T, typename Policy = single_thread_count>
+class ref_counted {
+public:
+    void add_ref() const noexcept { cpair.getFirst().increment(cpair.getSecond()); }
+    bool release_ref() const noexcept { return cpair.getFirst().decrement(cpair.getSecond()); }
+    bool try_add_ref() const noexcept { return cpair.getFirst().try_increment(cpair.getSecond()); }
+    int use_count() const noexcept { return cpair.getFirst().load(cpair.getSecond()); }
+
+    // intrusive_ptr가 ADL로 찾아서 호출한다 (hidden friend)
+    friend void intrusive_ptr_add_ref(const ref_counted* p) noexcept { p->add_ref(); }
+    friend void intrusive_ptr_release(const ref_counted* p) noexcept {
+        if (p->release_ref()) {
+            delete static_cast<const T*>(p);
+        }
+    }
+
+protected:
+    ref_counted() noexcept : cpair(zero_and_variadic_arg_t{}, 0) {}
+    // 객체가 복사되더라도 참조 카운트는 복사되면 안된다. 새 객체는 0부터 시작
+    ref_counted(const ref_counted&) noexcept : ref_counted() {}
+    ref_counted& operator =(const ref_counted&) noexcept { return *this; }
+    // static_cast<const T*>로 delete 하므로 ref_counted의 소멸자는 virtual일 필요가 없다
+    // 단, T는 실제 객체의 타입(most derived)이어야 한다. T를 다시 상속한 타입을 만든다면 T의 소멸자를 virtual로 만들어야 한다
+    ~ref_counted() = default;
+
+private:
+    // const 객체도 참조 카운트는 바뀌어야 하므로 mutable
+    mutable compressed_pair<Policy, typename Policy::count_type> cpair;
+};
+
+template<typename T>
+class intrusive_ptr {
+    template<typename U> friend class intrusive_ptr;
+public:
+    using element_type = T;
+    using pointer = T*;
+
+    intrusive_ptr() noexcept = default;
+    intrusive_ptr(std::nullptr_t) noexcept {}
+    // 이미 참조 카운트를 올려 둔 포인터를 넘길 때는 add_ref = false
+    explicit intrusive_ptr(pointer p, bool add_ref = true) noexcept : p(p) {
+        if (p && add_ref) intrusive_ptr_add_ref(p);
+    }
+
+    intrusive_ptr(const intrusive_ptr& ip) noexcept : intrusive_ptr(ip.p) {}
+    intrusive_ptr(intrusive_ptr&& ip) noexcept : p(std::exchange(ip.p, nullptr)) {}
+
+    // coercion by member template
+    // 마지막 참조가 사라질 때 T*로 delete 하므로, 다른 타입으로의 변환은 T의 소멸자가 virtual인 경우만 허용한다
+    // (U -> const U 처럼 cv만 다른 변환은 항상 가능)
+    // disjunction은 앞이 true면 뒤를 instantiate 하지 않으므로, 아직 불완전한 T끼리의 복사에도 쓸 수 있다
+    template<typename U>
+    static constexpr bool safe_coercion_v = std::conjunction_v<std::is_convertible<U*, T*>,
+        std::disjunction<std::is_same<std::remove_cv_t<U>, std::remove_cv_t<T>>, std::has_virtual_destructor<T>>>;
+
+    template<typename U, typename = std::enable_if_t<safe_coercion_v<U>>>
+    intrusive_ptr(const intrusive_ptr<U>& ip) noexcept : intrusive_ptr(ip.p) {}
+    template<typename U, typename = std::enable_if_t<safe_coercion_v<U>>>
+    intrusive_ptr(intrusive_ptr<U>&& ip) noexcept : p(std::exchange(ip.p, nullptr)) {}
+
+    ~intrusive_ptr() { if (p) intrusive_ptr_release(p); }
+
+    // copy and swap
+    intrusive_ptr& operator =(const intrusive_ptr& ip) noexcept {
+        intrusive_ptr(ip).swap(*this);
+        return *this;
+    }
+    intrusive_ptr& operator =(intrusive_ptr&& ip) noexcept {
+        intrusive_ptr(std::move(ip)).swap(*this);
+        return *this;
+    }
+
+    T& operator *() const noexcept { return *p; }
+    pointer operator ->() const noexcept { return p; }
+    pointer get() const noexcept { return p; }
+    explicit operator bool() const noexcept { return p != nullptr; }
+
+    // 참조 카운트를 줄이지 않고 소유권을 포기한다
+    pointer detach() noexcept { return std::exchange(p, nullptr); }
+    void reset(pointer ptr = nullptr) noexcept { intrusive_ptr(ptr).swap(*this); }
+    void swap(intrusive_ptr& ip) noexcept { std::swap(p, ip.p); }
+
+    friend bool operator ==(const intrusive_ptr& a, const intrusive_ptr& b) noexcept { return a.p == b.p; }
+
+private:
+    pointer p = nullptr;
+};
+
+template<typename T, typename ... Args>
+intrusive_ptr<T> make_intrusive(Args&& ... args) {
+    return intrusive_ptr<T>(new T(std::forward<Args>(args)...));
+}
@@ -0,0 +1,275 @@
+/*
+string interning
+- 같은 문자열을 가진 Label을 수백만개 만들면, Label마다 new char[] + strcpy를 하고, 비교할 때마다 strcmp를 한다
+- 전역 pool에 문자열을 한번만 저장하고(interning), Label은 pool의 entry를 가리키는 handle만 갖는다
+- 같은 문자열이면 같은 entry를 가리키므로 비교/해싱은 포인터 비교가 된다
+- pool은 여러 shard로 나누고 shard마다 mutex를 둬서 스레드들이 동시에 intern 할 수 있다
+- entry의 참조 카운트는 ref_counted<entry, atomic_count>로 entry 안에 넣고, 마지막 handle이 사라지면 pool에서 제거한다
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include "intrusive_ptr.hpp"
+
+namespace interned {
+    class string_pool;
+
+    struct entry : public ref_counted<entry, atomic_count> {
+        std::string text;
+        std::size_t hash;
+        bool linked = true; // pool에 등록되어 있는지. shard mutex로 보호된다
+
+        entry(std::string_view s, std::size_t hash) : text(s), hash(hash) {}
+
+        // ref_counted의 intrusive_ptr_release 대신 이 함수가 선택된다 (entry*가 더 정확히 일치하므로)
+        // 마지막 참조가 사라지면 delete 전에 pool에서 제거해야 한다
+        friend void intrusive_ptr_release(const entry* e) noexcept;
+    };
+
+    class string_pool {
+        static constexpr int shard_bits = 6;
+        static constexpr std::size_t shard_count = std::size_t(1) << shard_bits;
+
+        // shard끼리 같은 cache line을 공유하면 서로 다른 mutex를 잡아도 false sharing이 생긴다
+        struct alignas(64) shard {
+            std::mutex m;
+            // key는 entry::text를 가리키는 string_view 이므로 문자열을 한번 더 복사하지 않는다
+            std::unordered_map<std::string_view, entry*> map;
+        };
+        shard shards[shard_count];
+
+        shard& shard_of(std::size_t hash) noexcept {
+            // 하위 bit는 unordered_map의 bucket 선택에 쓰이므로 최상위 shard_bits개 bit로 shard를 고른다
+            // size_t가 32bit인 환경도 있으므로 shift 크기는 size_t의 bit 수에서 계산한다
+            return shards[hash >> (std::numeric_limits<std::size_t>::digits - shard_bits)];
+        }
+
+        string_pool() = default;
+    public:
+        string_pool(const string_pool&) = delete;
+        string_pool& operator =(const string_pool&) = delete;
+
+        static string_pool& instance() {
+            static string_pool pool;
+            return pool;
+        }
+
+        intrusive_ptr<const entry> intern(std::string_view s) {
+            std::size_t hash = std::hash<std::string_view>{}(s);
+            shard& sh = shard_of(hash);
+            std::lock_guard<std::mutex> g(sh.m);
+            auto it = sh.map.find(s);
+            if (it != sh.map.end()) {
+                // 참조 카운트가 0이면 다른 스레드가 지우는 중이다. 다시 살리지 말고 새로 만든다
+                if (it->second->try_add_ref()) {
+                    return intrusive_ptr<const entry>(it->second, false);
+                }
+                it->second->linked = false;
+                sh.map.erase(it);
+            }
+            entry* e = new entry(s, hash);
+            sh.map.emplace(std::string_view(e->text), e);
+            return intrusive_ptr<const entry>(e);
+        }
+
+        void release(const entry* e) noexcept {
+            {
+                shard& sh = shard_of(e->hash);
+                std::lock_guard<std::mutex> g(sh.m);
+                if (e->linked) {
+                    sh.map.erase(std::string_view(e->text));
+                }
+            }
+            delete e;
+        }
+
+        std::size_t size() {
+            std::size_t n = 0;
+            for (auto& sh : shards) {
+                std::lock_guard<std::mutex> g(sh.m);
+                n += sh.map.size();
+            }
+            return n;
+        }
+    };
+
+    // 참조 카운트는 0에서 다시 올라가지 않으므로(try_add_ref) release는 한 스레드에서만 호출된다
+    void intrusive_ptr_release(const entry* e) noexcept {
+        if (e->release_ref()) {
+            string_pool::instance().release(e);
+        }
+    }
+
+    // exams.cpp의 Label과 같은 interface
+    class Label {
+        intrusive_ptr<const entry> e;
+    public:
+        Label(const char* s) : e(string_pool::instance().intern(s)) {}
+        Label(std::string_view s) : e(string_pool::instance().intern(s)) {}
+
+        // 복사 생성자, 소멸자는 intrusive_ptr가 처리한다
+
+        struct temporary_proxy {
+            Label *lb;
+            int idx;
+
+            temporary_proxy(Label *lb, int idx) : lb(lb), idx(idx) {}
+
+            // entry는 공유되므로 직접 고치지 않고, 고친 문자열을 다시 intern 한다
+            temporary_proxy& operator =(char value) {
+                std::string text = lb->e->text;
+                text[idx] = value;
+                lb->e = string_pool::instance().intern(text);
+                return *this;
+            }
+
+            operator char() {
+                return lb->e->text[idx];
+            }
+        };
+
+        temporary_proxy operator [](int idx) {
+            return temporary_proxy(this, idx);
+        }
+
+        const char* c_str() const noexcept { return e->text.c_str(); }
+        std::size_t size() const noexcept { return e->text.size(); }
+        // 해시는 intern 할 때 계산해 두었다
+        std::size_t hash() const noexcept { return e->hash; }
+
+        // 같은 문자열이면 같은 entry 이므로 strcmp 대신 포인터 비교
+        friend bool operator ==(const Label& a, const Label& b) noexcept { return a.e == b.e; }
+
+        void print() const {
+            std::cout << e->text << " ref: " << e->use_count() << std::endl;
+        }
+    };
+}
+
+template<>
+struct std::hash<interned::Label> {
+    std::size_t operator ()(const interned::Label& lb) const noexcept { return lb.hash(); }
+};
+
+static void basic() {
+    interned::Label lb1("hello");
+    interned::Label lb2("hello"); // 따로 만들어도 같은 entry를 공유한다
+    lb1.print(); // hello ref: 2
+    std::cout << std::boolalpha << (lb1 == lb2) << std::endl; // true
+
+    lb1[0] = 'A';
+    lb1.print(); // Aello ref: 1
+    lb2.print(); // hello ref: 1
+    std::cout << (lb1 == lb2) << std::endl; // false
+
+    lb1[0] = 'h'; // 다시 같은 문자열이 되면 같은 entry
+    std::cout << (lb1 == lb2) << std::endl; // true
+    std::cout << interned::string_pool::instance().size() << std::endl; // 1
+}
+
+#include <thread>
+#include <vector>
+
+static void concurrent() {
+    auto worker = [](int id) {
+        for (int i = 0; i < 100000; ++i) {
+            interned::Label lb(std::to_string((i + id) % 100));
+            interned::Label copy = lb;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    // 모든 Label이 사라졌으므로 pool도 비어 있어야 한다
+    std::cout << interned::string_pool::instance().size() << std::endl; // 0
+}
+
+#include <chrono>
+#include <memory>
+
+// exams.cpp의 Label과 같은 방식(new char[] + strcpy + new int)으로 문자열을 복사하는 Label
+class copying_label {
+    char* text;
+    std::size_t size;
+    int* ref;
+public:
+    copying_label(const char* s) : size(strlen(s)), ref(new int(1)) {
+        text = new char[size + 1];
+        strcpy(text, s);
+    }
+    copying_label(const copying_label&) = delete;
+    copying_label(copying_label&& o) noexcept : text(std::exchange(o.text, nullptr)), size(o.size), ref(std::exchange(o.ref, nullptr)) {}
+    ~copying_label() {
+        delete ref;
+        delete[] text;
+    }
+    std::size_t length() const noexcept { return size; }
+    friend bool operator ==(const copying_label& a, const copying_label& b) noexcept { return strcmp(a.text, b.text) == 0; }
+};
+
+// 4096개의 서로 다른 문자열로 n개의 Label을 만들고, Label끼리 비교한다
+// 메모리가 부족하지 않도록 batch 단위로 만들고 지운다
+// 메모리 사용량은 측정값이 아니라 batch 기준으로 sizeof를 더한 추정값이다 (malloc 헤더, map node는 포인터 4개로 어림)
+static void benchmark(std::size_t n = 100'000'000, std::size_t batch = 10'000'000, std::size_t distinct = 4096) {
+    using clock = std::chrono::steady_clock;
+    std::vector<std::string> words;
+    for (std::size_t i = 0; i < distinct; ++i) {
+        words.push_back("label/" + std::to_string(i * 2654435761u % 1000003));
+    }
+
+    auto run = [&](const char* name, auto make, auto bytes) {
+        clock::duration build{}, compare{};
+        std::size_t equal = 0, footprint = 0;
+        for (std::size_t done = 0; done < n; done += batch) {
+            std::size_t count = std::min(batch, n - done);
+            auto start = clock::now();
+            std::vector<decltype(make(words[0]))> v;
+            v.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                v.push_back(make(words[(done + i) * 7 % distinct]));
+            }
+            auto built = clock::now();
+            // 홀수번째는 같은 문자열(distinct개 앞), 짝수번째는 다른 문자열(바로 앞)과 비교
+            for (std::size_t i = distinct; i < v.size(); ++i) {
+                equal += (v[i] == v[i % 2 ? i - distinct : i - 1]);
+            }
+            compare += clock::now() - built;
+            build += built - start;
+            footprint = std::max(footprint, bytes(v));
+        }
+        auto ms = [](auto d) { return std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+        std::cout << name << " build: " << ms(build) << "ms, compare: " << ms(compare) << "ms, equal: " << equal
+                  << ", estimated batch memory: " << footprint / (1024 * 1024) << "MB" << std::endl;
+    };
+
+    run("copying label", [](const std::string& s) { return copying_label(s.c_str()); },
+        [](const auto& v) {
+            std::size_t b = v.capacity() * sizeof(copying_label);
+            for (auto& lb : v) b += lb.length() + 1 + sizeof(int);
+            return b;
+        });
+    run("interned label", [](const std::string& s) { return interned::Label(std::string_view(s)); },
+        [](const auto& v) {
+            // handle + pool에 있는 entry. map node는 key, value, next, hash 정도로 어림한다
+            std::size_t entries = interned::string_pool::instance().size();
+            return v.capacity() * sizeof(interned::Label) + entries * (sizeof(interned::entry) + 4 * sizeof(void*));
+        });
+}
+
+void label_interning() {
+    basic();
+    concurrent();
+    benchmark();
+}
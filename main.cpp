@@ -4,11 +4,31 @@ extern void empty_class();
 extern void no_unique_address();
 extern void making_unique_ptr();
 extern void exams();
+extern void making_unique_array();
+extern void making_inline_ptr();
+extern void making_intrusive_ptr();
+extern void label_interning();
+extern void ring_buffer();
+extern void rcu();
+extern void sharded_map();
+extern void making_small_vector();
+extern void fused_pipeline();
+extern void rope_label();
 
 int main() {
     // empty_class();
     // no_unique_address();
     // making_unique_ptr();
     exams();
+    // making_unique_array();
+    // making_inline_ptr();
+    // making_intrusive_ptr();
+    // label_interning();
+    // ring_buffer();
+    // rcu();
+    // sharded_map();
+    // making_small_vector();
+    // fused_pipeline();
+    // rope_label();
     return 0;
 }
\ No newline at end of file
@@ -117,161 +117,7 @@ static void making_unique_ptr2() {
     unique_ptr<int, decltype([](int* p) {free(p);})> p1(static_cast<int*>(malloc(sizeof(int))));
 }
 
-#include <utility>
-#include "compressed_pair.hpp"
-namespace using_compressed_pair {
-    // 디폴트 삭제자도 템플릿으로 만든다
-    template<typename T> struct default_delete {
-        default_delete() = default;
-        template<typename U> default_delete(const default_delete<U>&) {}
-        void operator ()(T* p) const {
-            std::cout << "delete" << std::endl;
-            delete p;
-        }
-    };
-
-    // 배열 delete를 위해 부분 특수화
-    template<typename T> struct default_delete<T[]> {
-        default_delete() = default;
-        template<typename U> default_delete(const default_delete<U>&) {}
-        void operator ()(T* p) const {
-            std::cout << "delete" << std::endl;
-            delete[] p;
-        }
-    };
-
-    template <typename T, typename D = default_delete<T> > class unique_ptr
-    {
-    public:
-        using pointer = T*;
-        using element_type = T;
-        using deleter_type = D;
-
-        unique_ptr() : cpair(zero_and_variadic_arg_t{}) {}
-        unique_ptr(std::nullptr_t) 			: cpair(zero_and_variadic_arg_t{}) {}
-        explicit unique_ptr(pointer p) 		: cpair(zero_and_variadic_arg_t{}, p) {}
-        unique_ptr(pointer p, const D& d) 	: cpair(one_and_variadic_arg_t{}, d, p) {}
-        unique_ptr(pointer p, D&& d) 		: cpair(one_and_variadic_arg_t{}, std::move(d), p) {}
-
-        ~unique_ptr() { if (cpair.getSecond()) cpair.getFirst()(cpair.getSecond()); }
-
-        T& operator*()       const { return *cpair.getSecond(); }
-        pointer operator->() const { return cpair.getSecond(); }
-
-        // 멤버 함수 추가
-        pointer get() const { return cpair.getSecond(); }
-
-        D& get_deleter()  { return cpair.getFirst(); }
-        const D& get_deleter() const  { return cpair.getFirst(); }
-        explicit operator bool() const { return static_cast<bool>(cpair.getSecond()); }
-        // https://github.com/doxygen/doxygen/issues/8909
-        pointer release()  { return std::exchange(cpair.getSecond(), nullptr); }
-        void reset(pointer ptr = nullptr)
-        {
-            pointer old = std::exchange(cpair.getSecond(), ptr);
-            if (old) {
-                cpair.getFirst()(old);
-            }
-        }
-
-        void swap(unique_ptr& up)
-        {
-            std::swap(cpair.getFirst(),  up.cpair.getFirst());
-            std::swap(cpair.getSecond(), up.cpair.getSecond());
-        }
-
-        // 복사 생성자는 금지시키고
-        unique_ptr(const unique_ptr&) = delete;
-        unique_ptr& operator=(const unique_ptr&) = delete;
-
-        // move 생성자는 지원한다
-        template<typename T2, typename D2>
-        unique_ptr(unique_ptr<T2, D2>&& up)
-            : cpair(one_and_variadic_arg_t{}, std::forward<D2>(up.get_deleter()), up.release()) {}
-
-        template<typename T2, typename D2>
-        unique_ptr& operator=(unique_ptr<T2, D2>&& up)
-        {
-            if (this != std::addressof(up))
-            {
-                reset(up.release());   // pointer
-                cpair.getFirst()() = std::forward<D>(up.cpair.getFirst()); // deleter
-            }
-            return *this;
-        }
-
-    private:
-        compressed_pair<D, pointer> cpair;
-    };
-
-    // 배열 delete를 위해 부분 특수화
-    template <typename T, typename D> class unique_ptr<T[], D>
-    {
-    public:
-        using pointer = T*;
-        using element_type = T;
-        using deleter_type = D;
-
-        unique_ptr() : cpair(zero_and_variadic_arg_t{}) {}
-        unique_ptr(std::nullptr_t) 			: cpair(zero_and_variadic_arg_t{}) {}
-        explicit unique_ptr(pointer p) 		: cpair(zero_and_variadic_arg_t{}, p) {}
-        unique_ptr(pointer p, const D& d) 	: cpair(one_and_variadic_arg_t{}, d, p) {}
-        unique_ptr(pointer p, D&& d) 		: cpair(one_and_variadic_arg_t{}, std::move(d), p) {}
-
-        ~unique_ptr() { if (cpair.getSecond()) cpair.getFirst()(cpair.getSecond()); }
-
-        // 배열은 dereferencing 할 수 없으므로 * 연산자 오버로딩 구현하지 않음
-        // T& operator *()       const { return *cpair.getSecond(); }
-        // 배열은 indexing 해야 하므로 [] 연산자 오버로딩 구현
-        T& operator [](int idx)       const { return cpair.getSecond()[idx]; }
-        pointer operator ->() const { return cpair.getSecond(); }
-
-        // 멤버 함수 추가
-        pointer get() const { return cpair.getSecond(); }
-
-        D& get_deleter()  { return cpair.getFirst(); }
-        const D& get_deleter() const  { return cpair.getFirst(); }
-        explicit operator bool() const { return static_cast<bool>(cpair.getSecond()); }
-        // https://github.com/doxygen/doxygen/issues/8909
-        pointer release()  { return std::exchange(cpair.getSecond(), nullptr); }
-        void reset(pointer ptr = nullptr)
-        {
-            pointer old = std::exchange(cpair.getSecond(), ptr);
-            if (old) {
-                cpair.getFirst()(old);
-            }
-        }
-
-        void swap(unique_ptr& up)
-        {
-            std::swap(cpair.getFirst(),  up.cpair.getFirst());
-            std::swap(cpair.getSecond(), up.cpair.getSecond());
-        }
-
-        // 복사 생성자는 금지시키고
-        unique_ptr(const unique_ptr&) = delete;
-        unique_ptr& operator=(const unique_ptr&) = delete;
-
-        // move 생성자는 지원한다
-        template<typename T2, typename D2>
-        unique_ptr(unique_ptr<T2, D2>&& up)
-            : cpair(one_and_variadic_arg_t{}, std::forward<D2>(up.get_deleter()), up.release()) {}
-
-        template<typename T2, typename D2>
-        unique_ptr& operator=(unique_ptr<T2, D2>&& up)
-        {
-            if (this != std::addressof(up))
-            {
-                reset(up.release());   // pointer
-                cpair.getFirst()() = std::forward<D>(up.cpair.getFirst()); // deleter
-            }
-            return *this;
-        }
-
-    private:
-        compressed_pair<D, pointer> cpair;
-    };
-}
+#include "unique_ptr.hpp"
 
 static void making_unique_ptr3() {
     using_compressed_pair::unique_ptr<int> up1(new int);
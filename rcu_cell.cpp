@@ -0,0 +1,320 @@
+/*
+rcu_cell (read-copy-update)
+- Label과 temporary_proxy는 쓰기 전까지 공유하고, 쓸 때 떼어내서 복사한다 (copy on write)
+- 설정값이나 routing table처럼 여러 스레드가 계속 읽고 아주 가끔 바뀌는 데이터에 같은 아이디어를 쓴다
+- reader는 현재 버전의 snapshot을 얻는다. lock도 CAS 반복도 없이 atomic fetch_add 한번이다 (wait-free)
+- writer는 현재 버전을 복사해서 고친 다음, atomic exchange 한번으로 새 버전을 공개한다
+- 옛 버전은 그 버전을 보고 있는 마지막 snapshot이 사라질 때 지워진다
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// 참조 카운트를 둘로 나눈다 (split reference count)
+// - 외부 카운트: current 안에 버전 번호와 함께 들어있다. reader는 fetch_add 한번으로 버전 번호를 읽고 카운트를 올린다
+// - 내부 카운트: version::refs. snapshot이 사라질 때 내려간다
+// 버전이 교체되면 writer가 외부 카운트를 내부 카운트로 옮긴다. 내부 카운트가 0이 되는 순간 마지막 reader가 사라진 것이다
+// 현재 버전인 동안에는 내부 카운트에 bias를 더해 둬서, snapshot을 복사하고 지우는 중에 0이 되지 않게 한다
+// 포인터(48bit) 대신 버전 번호(16bit)를 넣었으므로 외부 카운트로 48bit를 쓸 수 있다
+// 외부 카운트는 버전이 교체될 때만 비워지므로, 오래 바뀌지 않는 버전은 넘칠 수 있다
+// 그래서 fold_threshold를 넘으면 reader가 외부 카운트를 내부 카운트로 옮긴다 (fold)
+template<typename T, std::size_t MaxVersions = 64>
+class rcu_cell {
+    friend struct rcu_cell_access;
+    static_assert(MaxVersions >= 2 && MaxVersions <= (1u << 16), "MaxVersions must fit in 16 bits");
+    static constexpr unsigned index_shift = 48;
+    static constexpr std::uint64_t count_mask = (std::uint64_t(1) << index_shift) - 1;
+    static constexpr std::int64_t bias = std::int64_t(1) << 62;
+    static constexpr std::uint64_t fold_threshold = std::uint64_t(1) << 40;
+
+    struct alignas(64) version {
+        std::atomic<std::int64_t> refs{0};
+        std::atomic<bool> busy{false};
+        const T* value = nullptr;
+    };
+
+public:
+    // reader가 들고 있는 handle. 살아 있는 동안 버전이 지워지지 않는다
+    class snapshot {
+        friend class rcu_cell;
+        rcu_cell* cell = nullptr;
+        version* v = nullptr;
+
+        snapshot(rcu_cell* cell, version* v) noexcept : cell(cell), v(v) {}
+    public:
+        snapshot() noexcept = default;
+        snapshot(const snapshot& s) noexcept : cell(s.cell), v(s.v) {
+            if (v) v->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        snapshot(snapshot&& s) noexcept : cell(std::exchange(s.cell, nullptr)), v(std::exchange(s.v, nullptr)) {}
+        snapshot& operator =(snapshot s) noexcept {
+            std::swap(cell, s.cell);
+            std::swap(v, s.v);
+            return *this;
+        }
+        ~snapshot() { if (v) cell->release(v); }
+
+        const T& operator *() const noexcept { return *v->value; }
+        const T* operator ->() const noexcept { return v->value; }
+        const T* get() const noexcept { return v ? v->value : nullptr; }
+        explicit operator bool() const noexcept { return v != nullptr; }
+    };
+
+    template<typename ... Args>
+    explicit rcu_cell(Args&& ... args) {
+        std::size_t i = acquire_slot();
+        versions[i].value = new T(std::forward<Args>(args)...);
+        current.store(std::uint64_t(i) << index_shift, std::memory_order_release);
+    }
+
+    // 살아 있는 snapshot이 없어야 한다
+    ~rcu_cell() {
+        retire(current.load(std::memory_order_relaxed));
+    }
+
+    rcu_cell(const rcu_cell&) = delete;
+    rcu_cell& operator =(const rcu_cell&) = delete;
+
+    // wait-free. 외부 카운트를 올리면서 현재 버전 번호를 읽는다
+    // 외부 카운트가 fold_threshold를 넘었을 때만 fold 한다 (2^40번에 한번)
+    snapshot read() noexcept {
+        std::uint64_t word = current.fetch_add(1, std::memory_order_acquire);
+        version* v = &versions[word >> index_shift];
+        if ((word & count_mask) >= fold_threshold) {
+            fold(word >> index_shift, *v);
+        }
+        return snapshot(this, v);
+    }
+
+    // 현재 값을 복사해서 f로 고친 다음 공개한다. writer끼리는 mutex로 순서를 정한다
+    template<typename F>
+    void update(F f) {
+        std::lock_guard<std::mutex> g(writer);
+        // writer가 mutex를 잡고 있는 동안 현재 버전은 바뀌지도, 지워지지도 않는다
+        const T* old = versions[current.load(std::memory_order_relaxed) >> index_shift].value;
+        // f가 예외를 던지면 복사본은 unique_ptr가 지운다
+        std::unique_ptr<T> copy = std::make_unique<T>(*old);
+        f(*copy);
+        publish(copy.release());
+    }
+
+    void store(T value) {
+        std::lock_guard<std::mutex> g(writer);
+        publish(new T(std::move(value)));
+    }
+
+private:
+    // 외부 카운트 c를 내부 카운트로 옮긴다
+    // 내부 카운트에 먼저 더하고 나서 current에서 뺀다. 잠시 더 많이 세는 것은 안전하지만, 덜 세면 너무 일찍 0이 될 수 있다
+    // 이 reader가 snapshot을 들고 있으므로 버전 칸은 재사용되지 않는다. current의 버전 번호가 같으면 같은 버전이다
+    void fold(std::uint64_t index, version& v) noexcept {
+        std::uint64_t word = current.load(std::memory_order_relaxed);
+        while ((word >> index_shift) == index) {
+            std::uint64_t c = word & count_mask;
+            if (c < fold_threshold) {
+                return; // 다른 reader가 이미 옮겼다
+            }
+            v.refs.fetch_add(static_cast<std::int64_t>(c), std::memory_order_acq_rel);
+            if (current.compare_exchange_weak(word, word - c, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return;
+            }
+            // 그 사이 다른 reader가 카운트를 올렸거나 writer가 버전을 바꿨다. 되돌리고 다시 본다
+            // 되돌린 뒤에도 이 reader의 참조가 남아 있으므로 0이 되지 않는다
+            v.refs.fetch_sub(static_cast<std::int64_t>(c), std::memory_order_acq_rel);
+        }
+    }
+
+    // 비어 있는 버전 칸을 찾는다
+    // 모든 칸을 옛 snapshot들이 붙잡고 있으면 하나가 풀릴 때까지 기다린다
+    std::size_t acquire_slot() {
+        for (;;) {
+            for (std::size_t i = 0; i < MaxVersions; ++i) {
+                bool expected = false;
+                if (!versions[i].busy.load(std::memory_order_relaxed) &&
+                    versions[i].busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    versions[i].refs.store(bias, std::memory_order_relaxed);
+                    return i;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void publish(const T* value) {
+        std::size_t i = acquire_slot();
+        versions[i].value = value;
+        std::uint64_t old = current.exchange(std::uint64_t(i) << index_shift, std::memory_order_acq_rel);
+        retire(old);
+    }
+
+    // 교체된 버전의 외부 카운트를 내부 카운트로 옮긴다. 그 사이 모든 reader가 이미 사라졌다면 여기서 지운다
+    void retire(std::uint64_t word) noexcept {
+        version& v = versions[word >> index_shift];
+        auto delta = static_cast<std::int64_t>(word & count_mask) - bias;
+        if (v.refs.fetch_add(delta, std::memory_order_acq_rel) + delta == 0) {
+            reclaim(v);
+        }
+    }
+
+    // 교체 전에는 bias 때문에 0 근처로 내려가지 않으므로, 1 -> 0이 되는 것은 교체 후 마지막 snapshot 뿐이다
+    void release(version* v) noexcept {
+        if (v->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            reclaim(*v);
+        }
+    }
+
+    void reclaim(version& v) noexcept {
+        delete std::exchange(v.value, nullptr);
+        v.busy.store(false, std::memory_order_release);
+    }
+
+    version versions[MaxVersions];
+    alignas(64) std::atomic<std::uint64_t> current{0};
+    std::mutex writer;
+};
+
+#include <iostream>
+#include <map>
+#include <string>
+
+struct Config {
+    std::string name;
+    int timeout = 0;
+    Config(std::string name, int timeout) : name(std::move(name)), timeout(timeout) {}
+    Config(const Config& c) : name(c.name), timeout(c.timeout) { std::cout << "copy " << name << std::endl; }
+    ~Config() { std::cout << "deleted " << name << " " << timeout << std::endl; }
+};
+
+static void basic() {
+    rcu_cell<Config> cell("server", 10);
+
+    auto s1 = cell.read();
+    std::cout << s1->name << " " << s1->timeout << std::endl; // server 10
+
+    // writer는 복사본을 고쳐서 공개한다. s1은 계속 옛 버전을 본다
+    cell.update([](Config& c) { c.timeout = 20; }); // copy server
+    auto s2 = cell.read();
+    std::cout << s1->timeout << ", " << s2->timeout << std::endl; // 10, 20
+
+    // 옛 버전을 보는 마지막 snapshot이 사라지면 지워진다
+    s1 = {}; // deleted server 10
+    std::cout << "end" << std::endl;
+} // deleted server 20
+
+#include <vector>
+
+// 외부 카운트를 직접 바꿔서, 오래 바뀌지 않고 아주 많이 읽힌 버전을 흉내낸다
+struct rcu_cell_access {
+    // n번 읽고 모두 놓은 상태로 만든다. 살아 있는 snapshot이 없어야 한다
+    template<typename T, std::size_t M>
+    static void set_reads(rcu_cell<T, M>& cell, std::uint64_t n) {
+        using cell_type = rcu_cell<T, M>;
+        std::uint64_t word = cell.current.load();
+        std::uint64_t old = word & cell_type::count_mask;
+        cell.versions[word >> cell_type::index_shift].refs -= static_cast<std::int64_t>(n - old);
+        cell.current.store((word & ~cell_type::count_mask) | n);
+    }
+
+    template<typename T, std::size_t M>
+    static std::uint64_t reads(rcu_cell<T, M>& cell) { return cell.current.load() & rcu_cell<T, M>::count_mask; }
+};
+
+static void overflow() {
+    rcu_cell<Config> cell("fold", 1);
+    // 2^48 - 2번 읽은 상태. fold가 없다면 두번 더 읽을 때 카운트가 버전 번호 bit로 넘친다
+    rcu_cell_access::set_reads(cell, (std::uint64_t(1) << 48) - 2);
+    std::vector<rcu_cell<Config>::snapshot> snaps;
+    for (int i = 0; i < 4; ++i) {
+        snaps.push_back(cell.read());
+    }
+    bool same = true;
+    for (auto& s : snaps) {
+        same = same && s.get() == snaps[0].get() && s->timeout == 1;
+    }
+    // 첫 read가 외부 카운트를 내부 카운트로 옮겼으므로 나머지 3번만 남아 있다
+    std::cout << std::boolalpha << same << ", " << rcu_cell_access::reads(cell) << std::endl; // true, 3
+
+    // 옮긴 뒤에도 참조 카운트가 맞아야 옛 버전이 정확히 한번 지워진다
+    snaps.clear();
+    cell.update([](Config& c) { c.timeout = 2; }); // copy fold, deleted fold 1
+    std::cout << cell.read()->timeout << std::endl; // 2
+} // deleted fold 2
+
+#include <chrono>
+#include <shared_mutex>
+#include <vector>
+
+// readers개의 스레드가 routing table을 계속 조회하고, writer 1개가 period마다 table을 고친다 (updates번)
+// reader는 duration이 지나면 스스로 멈춘다. batch번 조회할 때마다 양보해서 writer가 lock을 잡을 기회를 준다
+// writer가 updates번을 다 고치지 못했다면(starvation) 조회 횟수는 비교할 수 없으므로 출력하지 않는다
+static void benchmark(int readers = 16, std::chrono::milliseconds duration = std::chrono::milliseconds(1000),
+                      int updates = 200, std::chrono::microseconds period = std::chrono::microseconds(1000), int batch = 64) {
+    using clock = std::chrono::steady_clock;
+    using table = std::map<int, int>;
+    table initial;
+    for (int i = 0; i < 1024; ++i) {
+        initial[i] = i;
+    }
+
+    auto run = [&](const char* name, auto lookup, auto modify) {
+        std::atomic<long long> reads{0}, sink{0};
+        auto start = clock::now();
+        auto deadline = start + duration;
+        std::vector<std::thread> threads;
+        for (int r = 0; r < readers; ++r) {
+            threads.emplace_back([&, r] {
+                long long n = 0, sum = 0;
+                for (int key = r;;) {
+                    for (int i = 0; i < batch; ++i, ++n, key = (key + 7) & 1023) {
+                        sum += lookup(key);
+                    }
+                    if (clock::now() >= deadline) {
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+                reads += n;
+                sink += sum; // 조회 결과를 사용해서 최적화로 사라지지 않도록
+            });
+        }
+        int writes = 0;
+        for (; writes < updates && clock::now() < deadline; ++writes) {
+            modify(writes & 1023);
+            std::this_thread::sleep_for(period);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        if (writes == updates) {
+            std::cout << name << ": " << static_cast<long long>(reads.load() / seconds) << " reads/s, " << writes << " updates" << std::endl;
+        } else {
+            std::cout << name << ": writer starved, " << writes << "/" << updates << " updates. reads are not comparable" << std::endl;
+        }
+    };
+
+    {
+        rcu_cell<table> cell(initial);
+        run("rcu_cell",
+            [&](int key) { return cell.read()->at(key); },
+            [&](int key) { cell.update([key](table& t) { ++t[key]; }); });
+    }
+    {
+        std::shared_mutex m;
+        table t = initial;
+        run("std::shared_mutex",
+            [&](int key) { std::shared_lock g(m); return t.at(key); },
+            [&](int key) { std::unique_lock g(m); ++t[key]; });
+    }
+}
+
+void rcu() {
+    basic();
+    overflow();
+    benchmark();
+}
@@ -0,0 +1,505 @@
+/*
+lock-free ring buffer
+- pipeline 단계 사이에서 unique_ptr의 소유권을 넘길 때 mutex + std::deque를 쓰면, 원소마다 lock을 잡고 deque가 주기적으로 할당을 한다
+- 크기가 고정된 ring buffer를 미리 만들어 두고 atomic index로만 동기화한다. 할당도 lock도 없다
+- 원소는 raw storage에 placement new로 move 생성하고, 꺼낼 때 move 한 뒤 소멸시킨다. 그래서 unique_ptr 같은 move-only 타입을 넣을 수 있다
+- spsc_ring: producer 1개, consumer 1개. 상대편 index를 캐시해서 atomic load를 줄인다
+- mpmc_ring: producer 여러개, consumer 여러개. 칸마다 sequence 번호를 둔다 (Dmitry Vyukov의 bounded MPMC queue)
+- try_push_n / try_pop_n으로 여러개를 한번에 넘기면 index 동기화 비용을 원소 개수만큼 나눌 수 있다
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "unique_ptr.hpp"
+
+// 서로 다른 스레드가 쓰는 변수를 다른 cache line에 두기 위해 사용 (false sharing 방지)
+constexpr std::size_t cache_line = 64;
+
+template<typename T, std::size_t Capacity>
+class spsc_ring {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static constexpr std::size_t mask = Capacity - 1;
+public:
+    using value_type = T;
+
+    spsc_ring() = default;
+    ~spsc_ring() {
+        while (try_pop()) {
+        }
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator =(const spsc_ring&) = delete;
+
+    // producer 스레드에서만 호출
+    template<typename U>
+    bool try_push(U&& value) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head == Capacity) {
+            // 캐시된 head로 보면 가득 찼다. 실제 head를 다시 읽는다
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head == Capacity) {
+                return false;
+            }
+        }
+        ::new(static_cast<void*>(slot(t))) T(std::forward<U>(value));
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // first부터 최대 n개를 move 해서 넣고, 넣은 개수를 리턴한다
+    template<typename It>
+    std::size_t try_push_n(It first, std::size_t n) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (Capacity - (t - cached_head) < n) {
+            cached_head = head.load(std::memory_order_acquire);
+        }
+        std::size_t k = std::min(n, Capacity - (t - cached_head));
+        for (std::size_t i = 0; i < k; ++i, ++first) {
+            ::new(static_cast<void*>(slot(t + i))) T(std::move(*first));
+        }
+        // release store 한번으로 k개를 한꺼번에 공개한다
+        tail.store(t + k, std::memory_order_release);
+        return k;
+    }
+
+    // consumer 스레드에서만 호출
+    std::optional<T> try_pop() {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail) {
+                return std::nullopt;
+            }
+        }
+        T* p = slot(h);
+        std::optional<T> result(std::move(*p));
+        p->~T();
+        head.store(h + 1, std::memory_order_release);
+        return result;
+    }
+
+    // 최대 n개를 out으로 move 하고, 꺼낸 개수를 리턴한다
+    template<typename OutIt>
+    std::size_t try_pop_n(OutIt out, std::size_t n) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (cached_tail - h < n) {
+            cached_tail = tail.load(std::memory_order_acquire);
+        }
+        std::size_t k = std::min(n, cached_tail - h);
+        for (std::size_t i = 0; i < k; ++i) {
+            T* p = slot(h + i);
+            *out++ = std::move(*p);
+            p->~T();
+        }
+        head.store(h + k, std::memory_order_release);
+        return k;
+    }
+
+private:
+    T* slot(std::size_t i) noexcept { return std::launder(reinterpret_cast<T*>(storage[i & mask].data)); }
+
+    struct cell {
+        alignas(T) unsigned char data[sizeof(T)];
+    };
+
+    // consumer가 쓰는 변수
+    alignas(cache_line) std::atomic<std::size_t> head{0};
+    std::size_t cached_tail = 0;
+    // producer가 쓰는 변수
+    alignas(cache_line) std::atomic<std::size_t> tail{0};
+    std::size_t cached_head = 0;
+    alignas(cache_line) cell storage[Capacity];
+};
+
+template<typename T, std::size_t Capacity>
+class mpmc_ring {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static constexpr std::size_t mask = Capacity - 1;
+public:
+    using value_type = T;
+
+    // 칸 i의 sequence는 i로 시작한다
+    // sequence == pos      : 비어 있음. pos번째 push가 쓸 수 있다
+    // sequence == pos + 1  : 채워져 있음. pos번째 pop이 읽을 수 있다
+    // pop이 끝나면 sequence = pos + Capacity. 한 바퀴 뒤의 push가 쓸 수 있다
+    mpmc_ring() {
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~mpmc_ring() {
+        while (try_pop()) {
+        }
+    }
+
+    mpmc_ring(const mpmc_ring&) = delete;
+    mpmc_ring& operator =(const mpmc_ring&) = delete;
+
+    template<typename U>
+    bool try_push(U&& value) {
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell& c = cells[pos & mask];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ::new(static_cast<void*>(c.data)) T(std::forward<U>(value));
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // 가득 참
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> try_pop() {
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell& c = cells[pos & mask];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return take(c, pos);
+                }
+            } else if (diff < 0) {
+                return std::nullopt; // 비어 있음
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // pos부터 이미 비어 있는 칸이 연속으로 몇 개인지 센 다음, 정확히 그만큼만 CAS 한번으로 예약한다
+    // 예약한 칸은 모두 바로 쓸 수 있으므로 다른 스레드를 기다리지 않는다 (try_push와 같은 lock-free)
+    template<typename It>
+    std::size_t try_push_n(It first, std::size_t n) {
+        if (n == 0) {
+            return 0;
+        }
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        std::size_t k;
+        for (;;) {
+            auto diff = static_cast<std::ptrdiff_t>(cells[pos & mask].seq.load(std::memory_order_acquire) - pos);
+            if (diff < 0) {
+                return 0; // 가득 참
+            }
+            if (diff > 0) {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+                continue;
+            }
+            k = ready_run(pos, std::min(n, Capacity), 0);
+            // enqueue_pos가 pos 그대로라면 그 사이 아무도 이 칸들을 예약하지 않았다
+            if (enqueue_pos.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for (std::size_t i = 0; i < k; ++i, ++first) {
+            cell& c = cells[(pos + i) & mask];
+            ::new(static_cast<void*>(c.data)) T(std::move(*first));
+            c.seq.store(pos + i + 1, std::memory_order_release);
+        }
+        return k;
+    }
+
+    // push_n과 반대로, 이미 채워진 칸이 연속으로 몇 개인지 센 다음 그만큼만 예약한다
+    // 예약만 하고 아직 쓰지 않은 producer의 칸은 가져가지 않는다
+    template<typename OutIt>
+    std::size_t try_pop_n(OutIt out, std::size_t n) {
+        if (n == 0) {
+            return 0;
+        }
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        std::size_t k;
+        for (;;) {
+            auto diff = static_cast<std::ptrdiff_t>(cells[pos & mask].seq.load(std::memory_order_acquire) - (pos + 1));
+            if (diff < 0) {
+                return 0; // 비어 있음
+            }
+            if (diff > 0) {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+                continue;
+            }
+            k = ready_run(pos, std::min(n, Capacity), 1);
+            if (dequeue_pos.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for (std::size_t i = 0; i < k; ++i) {
+            *out++ = take(cells[(pos + i) & mask], pos + i);
+        }
+        return k;
+    }
+
+private:
+    struct cell {
+        std::atomic<std::size_t> seq;
+        alignas(T) unsigned char data[sizeof(T)];
+    };
+
+    // pos부터 seq == pos + i + offset 인 칸이 연속으로 몇 개인지 센다 (최대 n개, 첫 칸은 확인된 상태)
+    // 비어 있는 칸은 offset 0, 채워진 칸은 offset 1
+    std::size_t ready_run(std::size_t pos, std::size_t n, std::size_t offset) const noexcept {
+        std::size_t k = 1;
+        while (k < n && cells[(pos + k) & mask].seq.load(std::memory_order_acquire) == pos + k + offset) {
+            ++k;
+        }
+        return k;
+    }
+
+    T take(cell& c, std::size_t pos) {
+        T* p = std::launder(reinterpret_cast<T*>(c.data));
+        T result(std::move(*p));
+        p->~T();
+        c.seq.store(pos + Capacity, std::memory_order_release);
+        return result;
+    }
+
+    alignas(cache_line) std::atomic<std::size_t> enqueue_pos{0};
+    alignas(cache_line) std::atomic<std::size_t> dequeue_pos{0};
+    alignas(cache_line) cell cells[Capacity];
+};
+
+#include <iostream>
+
+struct Message {
+    int id;
+    explicit Message(int id) : id(id) {}
+};
+
+using message_ptr = using_compressed_pair::unique_ptr<Message, using_compressed_pair::quiet_delete<Message>>;
+
+static void basic() {
+    spsc_ring<message_ptr, 4> q;
+    std::cout << std::boolalpha;
+    std::cout << q.try_push(message_ptr(new Message(1))) << std::endl; // true
+
+    message_ptr batch[] = {message_ptr(new Message(2)), message_ptr(new Message(3)), message_ptr(new Message(4)), message_ptr(new Message(5))};
+    // 남은 칸이 3개이므로 3개만 들어간다. 소유권이 넘어간 원소는 비어 있다
+    std::cout << q.try_push_n(batch, 4) << ", " << static_cast<bool>(batch[0]) << ", " << static_cast<bool>(batch[3]) << std::endl; // 3, false, true
+
+    std::optional<message_ptr> m = q.try_pop();
+    std::cout << (*m)->id << std::endl; // 1
+
+    message_ptr out[4];
+    std::size_t n = q.try_pop_n(out, 4);
+    std::cout << n << ": " << out[0]->id << out[1]->id << out[2]->id << std::endl; // 3: 234
+
+    mpmc_ring<message_ptr, 4> mq;
+    mq.try_push(std::move(batch[3]));
+    std::cout << mq.try_pop().value()->id << ", " << mq.try_pop().has_value() << std::endl; // 5, false
+}
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// 벤치마크 비교 대상. mutex + std::deque
+template<typename T>
+class locked_deque {
+    std::mutex m;
+    std::deque<T> q;
+public:
+    template<typename U>
+    bool try_push(U&& value) {
+        std::lock_guard<std::mutex> g(m);
+        q.push_back(std::forward<U>(value));
+        return true;
+    }
+    template<typename It>
+    std::size_t try_push_n(It first, std::size_t n) {
+        std::lock_guard<std::mutex> g(m);
+        for (std::size_t i = 0; i < n; ++i, ++first) {
+            q.push_back(std::move(*first));
+        }
+        return n;
+    }
+    std::optional<T> try_pop() {
+        std::lock_guard<std::mutex> g(m);
+        if (q.empty()) {
+            return std::nullopt;
+        }
+        std::optional<T> result(std::move(q.front()));
+        q.pop_front();
+        return result;
+    }
+    template<typename OutIt>
+    std::size_t try_pop_n(OutIt out, std::size_t n) {
+        std::lock_guard<std::mutex> g(m);
+        std::size_t k = std::min(n, q.size());
+        for (std::size_t i = 0; i < k; ++i) {
+            *out++ = std::move(q.front());
+            q.pop_front();
+        }
+        return k;
+    }
+};
+
+struct TimedMessage {
+    std::chrono::steady_clock::time_point sent;
+};
+
+using timed_ptr = using_compressed_pair::unique_ptr<TimedMessage, using_compressed_pair::quiet_delete<TimedMessage>>;
+
+// producer 1개, consumer 1개가 n개의 unique_ptr를 넘긴다
+// 처리량과 push ~ pop 사이의 지연시간(p50, p99)을 잰다. batch > 1 이면 try_push_n / try_pop_n을 쓴다
+template<typename Queue>
+static void run_benchmark(const char* name, std::size_t n, std::size_t batch) {
+    using clock = std::chrono::steady_clock;
+    Queue q;
+    std::vector<clock::duration> latency;
+    latency.reserve(n / batch + 1);
+
+    auto start = clock::now();
+    std::thread producer([&] {
+        std::vector<timed_ptr> buf(batch);
+        for (std::size_t sent = 0; sent < n;) {
+            std::size_t k = std::min(batch, n - sent);
+            auto now = clock::now();
+            for (std::size_t i = 0; i < k; ++i) {
+                buf[i] = timed_ptr(new TimedMessage{now});
+            }
+            std::size_t pushed = 0;
+            while (pushed < k) {
+                std::size_t r = batch == 1 ? q.try_push(std::move(buf[0])) : q.try_push_n(buf.begin() + pushed, k - pushed);
+                pushed += r;
+                if (r == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            sent += k;
+        }
+    });
+    std::thread consumer([&] {
+        std::vector<timed_ptr> buf(batch);
+        for (std::size_t received = 0; received < n;) {
+            std::size_t r;
+            if (batch == 1) {
+                std::optional<timed_ptr> m = q.try_pop();
+                r = m.has_value();
+                if (r) buf[0] = std::move(*m);
+            } else {
+                r = q.try_pop_n(buf.begin(), batch);
+            }
+            if (r == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            // batch의 첫 원소로 지연시간을 샘플링한다
+            latency.push_back(clock::now() - buf[0]->sent);
+            for (std::size_t i = 0; i < r; ++i) {
+                buf[i].reset();
+            }
+            received += r;
+        }
+    });
+    producer.join();
+    consumer.join();
+    auto elapsed = clock::now() - start;
+
+    std::sort(latency.begin(), latency.end());
+    auto us = [](auto d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count(); };
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    std::cout << name << " batch " << batch << ": " << ms << "ms, "
+              << static_cast<long long>(n / std::max<double>(std::chrono::duration<double>(elapsed).count(), 1e-9)) << " msg/s, "
+              << "latency p50 " << us(latency[latency.size() / 2]) << "us, p99 " << us(latency[latency.size() * 99 / 100]) << "us" << std::endl;
+}
+
+// producers개, consumers개의 스레드가 n개의 unique_ptr를 주고 받는다
+// producer는 try_push와 try_push_n(batch개)을 번갈아 쓰고, consumer는 try_pop_n으로 꺼낸다
+// 모든 원소가 정확히 한번씩 도착했는지 id의 개수와 합으로 확인한다
+template<typename Queue>
+static void run_mpmc_benchmark(const char* name, std::size_t n, int producers, int consumers, std::size_t batch) {
+    using clock = std::chrono::steady_clock;
+    Queue q;
+    std::atomic<std::size_t> received{0};
+    std::atomic<unsigned long long> id_sum{0};
+    std::size_t per = n / producers;
+    n = per * producers;
+
+    auto start = clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            std::vector<message_ptr> buf(batch);
+            std::size_t first = p * per, last = first + per;
+            for (std::size_t id = first, round = 0; id < last; ++round) {
+                std::size_t k = std::min(batch, last - id);
+                for (std::size_t i = 0; i < k; ++i) {
+                    buf[i] = message_ptr(new Message(static_cast<int>(id + i)));
+                }
+                for (std::size_t pushed = 0; pushed < k;) {
+                    // 짝수 round는 하나씩, 홀수 round는 한번에
+                    std::size_t r = round % 2 ? q.try_push_n(buf.begin() + pushed, k - pushed) : q.try_push(std::move(buf[pushed]));
+                    pushed += r;
+                    if (r == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+                id += k;
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            std::vector<message_ptr> buf(batch);
+            unsigned long long sum = 0;
+            while (received.load(std::memory_order_relaxed) < n) {
+                std::size_t r = q.try_pop_n(buf.begin(), batch);
+                if (r == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (std::size_t i = 0; i < r; ++i) {
+                    sum += buf[i]->id;
+                    buf[i].reset();
+                }
+                received.fetch_add(r, std::memory_order_relaxed);
+            }
+            id_sum += sum;
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto elapsed = clock::now() - start;
+
+    unsigned long long expected = static_cast<unsigned long long>(n) * (n - 1) / 2;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    std::cout << name << " " << producers << "P/" << consumers << "C batch " << batch << ": " << ms << "ms, "
+              << static_cast<long long>(n / std::max<double>(std::chrono::duration<double>(elapsed).count(), 1e-9)) << " msg/s";
+    if (received.load() != n || id_sum.load() != expected) {
+        std::cout << ", MISMATCH received " << received.load() << "/" << n << ", id sum " << id_sum.load() << "/" << expected;
+    }
+    std::cout << std::endl;
+}
+
+static void benchmark(std::size_t n = 10'000'000) {
+    for (std::size_t batch : {1, 32}) {
+        run_benchmark<locked_deque<timed_ptr>>("mutex + deque", n, batch);
+        run_benchmark<spsc_ring<timed_ptr, 4096>>("spsc_ring", n, batch);
+        run_benchmark<mpmc_ring<timed_ptr, 4096>>("mpmc_ring", n, batch);
+    }
+    // 여러 producer/consumer. spsc_ring은 쓸 수 없다
+    run_mpmc_benchmark<locked_deque<message_ptr>>("mutex + deque", n, 4, 4, 32);
+    run_mpmc_benchmark<mpmc_ring<message_ptr, 4096>>("mpmc_ring", n, 4, 4, 32);
+}
+
+void ring_buffer() {
+    basic();
+    benchmark();
+}
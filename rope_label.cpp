@@ -0,0 +1,382 @@
+/*
+rope Label
+- exams.cpp의 Label은 만들 때와 쓰기 전에 떼어낼 때마다 문자열 전체를 복사한다
+- 조각을 계속 이어 붙여서 긴 Label을 만들면 매번 전체를 복사하므로 O(n^2)이 된다
+- rope: 문자열을 변하지 않는 조각(chunk)들의 균형 이진 트리로 표현한다
+  - chunk와 node는 만든 뒤에 바뀌지 않으므로 여러 Label이 참조 카운트로 공유한다 (ref_counted, intrusive_ptr)
+  - 이어 붙이기, 부분 문자열은 트리의 일부만 새로 만들고 나머지는 공유한다. AVL 처럼 높이를 맞추므로 O(log n)
+  - 연속된 메모리가 필요할 때(c_str, view, print) 처음 한번만 하나의 chunk로 펼친다 (lazy flatten)
+- 작은 조각이 이어지면 node가 너무 많아지므로 small_leaf 이하의 leaf는 복사해서 합친다
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "intrusive_ptr.hpp"
+
+namespace rope {
+    // 문자열 조각. 끝에 '\0'을 붙여 두므로 chunk 끝까지 쓰는 leaf는 그대로 c_str()이 된다
+    struct chunk : public ref_counted<chunk> {
+        std::size_t size;
+        std::unique_ptr<char[]> text;
+        explicit chunk(std::size_t size) : size(size), text(new char[size + 1]) { text[size] = '\0'; }
+    };
+
+    // leaf: chunk의 [offset, offset + length) 구간. 부분 문자열은 chunk를 복사하지 않고 구간만 줄인다
+    // concat: left + right
+    struct node : public ref_counted<node> {
+        std::size_t length = 0;
+        unsigned height = 0; // leaf는 0
+        intrusive_ptr<const chunk> text;
+        std::size_t offset = 0;
+        intrusive_ptr<const node> left, right;
+
+        bool is_leaf() const noexcept { return !left; }
+    };
+
+    using node_ptr = intrusive_ptr<const node>;
+
+    // 이 길이 이하의 조각끼리는 node를 만들지 않고 복사해서 합친다
+    constexpr std::size_t small_leaf = 128;
+
+    inline unsigned height(const node_ptr& t) noexcept { return t ? t->height : 0; }
+
+    inline node_ptr make_leaf(intrusive_ptr<const chunk> text, std::size_t offset, std::size_t length) {
+        auto n = make_intrusive<node>();
+        n->length = length;
+        n->text = std::move(text);
+        n->offset = offset;
+        return n;
+    }
+
+    inline node_ptr make_concat(node_ptr l, node_ptr r) {
+        auto n = make_intrusive<node>();
+        n->length = l->length + r->length;
+        n->height = std::max(l->height, r->height) + 1;
+        n->left = std::move(l);
+        n->right = std::move(r);
+        return n;
+    }
+
+    inline void copy_to(const node* t, char* dst) {
+        for (; !t->is_leaf(); t = t->right.get()) {
+            copy_to(t->left.get(), dst);
+            dst += t->left->length;
+        }
+        std::memcpy(dst, t->text->text.get() + t->offset, t->length);
+    }
+
+    // 트리 전체를 새 chunk 하나로 복사한다
+    inline node_ptr flatten(const node_ptr& t) {
+        auto c = make_intrusive<chunk>(t->length);
+        copy_to(t.get(), c->text.get());
+        return make_leaf(std::move(c), 0, t->length);
+    }
+
+    inline node_ptr from_string(std::string_view s) {
+        if (s.empty()) {
+            return nullptr;
+        }
+        auto c = make_intrusive<chunk>(s.size());
+        std::memcpy(c->text.get(), s.data(), s.size());
+        return make_leaf(std::move(c), 0, s.size());
+    }
+
+    // 양쪽 높이 차이가 2가 된 경우 회전해서 다시 맞춘다. 회전도 node를 새로 만들 뿐 기존 node는 고치지 않는다
+    inline node_ptr balance(node_ptr l, node_ptr r) {
+        if (r->height > l->height + 1) {
+            if (r->left->height > r->right->height) {
+                const node_ptr& rl = r->left;
+                return make_concat(make_concat(std::move(l), rl->left), make_concat(rl->right, r->right));
+            }
+            return make_concat(make_concat(std::move(l), r->left), r->right);
+        }
+        if (l->height > r->height + 1) {
+            if (l->right->height > l->left->height) {
+                const node_ptr& lr = l->right;
+                return make_concat(make_concat(l->left, lr->left), make_concat(lr->right, std::move(r)));
+            }
+            return make_concat(l->left, make_concat(l->right, std::move(r)));
+        }
+        return make_concat(std::move(l), std::move(r));
+    }
+
+    // 낮은 쪽 트리를 높은 쪽 트리의 가장자리를 따라 높이가 비슷한 곳까지 내려가서 붙인다. O(높이 차이)
+    // 작은 조각을 붙일 때는 가장자리의 leaf까지 내려가서 small_leaf 이하면 합친다
+    inline node_ptr join(const node_ptr& l, const node_ptr& r) {
+        if (!l) return r;
+        if (!r) return l;
+        if (l->length + r->length <= small_leaf) {
+            std::size_t n = l->length + r->length;
+            auto c = make_intrusive<chunk>(n);
+            copy_to(l.get(), c->text.get());
+            copy_to(r.get(), c->text.get() + l->length);
+            return make_leaf(std::move(c), 0, n);
+        }
+        if (!l->is_leaf() && (l->height > r->height + 1 || r->length <= small_leaf)) {
+            return balance(l->left, join(l->right, r));
+        }
+        if (!r->is_leaf() && (r->height > l->height + 1 || l->length <= small_leaf)) {
+            return balance(join(l, r->left), r->right);
+        }
+        return make_concat(l, r);
+    }
+
+    // [pos, pos + n). 구간에 완전히 들어가는 subtree는 그대로 공유하고, 경계에 걸친 경로만 새로 만든다
+    inline node_ptr slice(const node_ptr& t, std::size_t pos, std::size_t n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        if (pos == 0 && n == t->length) {
+            return t;
+        }
+        if (t->is_leaf()) {
+            return make_leaf(t->text, t->offset + pos, n);
+        }
+        std::size_t l = t->left->length;
+        if (pos + n <= l) {
+            return slice(t->left, pos, n);
+        }
+        if (pos >= l) {
+            return slice(t->right, pos - l, n);
+        }
+        return join(slice(t->left, pos, l - pos), slice(t->right, 0, pos + n - l));
+    }
+
+    inline char char_at(const node* t, std::size_t idx) noexcept {
+        while (!t->is_leaf()) {
+            if (idx < t->left->length) {
+                t = t->left.get();
+            } else {
+                idx -= t->left->length;
+                t = t->right.get();
+            }
+        }
+        return t->text->text[t->offset + idx];
+    }
+
+    // exams.cpp의 Label과 같은 interface
+    class Label {
+        // 펼치는 것은 값을 바꾸지 않으므로 const 함수에서도 root를 바꾼다
+        mutable node_ptr root;
+
+        explicit Label(node_ptr root) noexcept : root(std::move(root)) {}
+
+        // 연속된 메모리가 필요하면 펼친다. 이미 leaf면 그대로 쓴다
+        const node* contiguous() const {
+            if (!root->is_leaf()) {
+                root = flatten(root);
+            }
+            return root.get();
+        }
+    public:
+        Label() noexcept = default;
+        Label(const char* s) : root(from_string(s)) {}
+        Label(std::string_view s) : root(from_string(s)) {}
+
+        // 복사 생성자, 소멸자는 intrusive_ptr가 처리한다
+
+        struct temporary_proxy {
+            Label *lb;
+            int idx;
+
+            temporary_proxy(Label *lb, int idx) : lb(lb), idx(idx) {}
+
+            // node는 공유되므로 직접 고치지 않는다. idx 앞, 새 문자, idx 뒤를 다시 이어 붙인다. O(log n)
+            temporary_proxy& operator =(char value) {
+                const node_ptr& t = lb->root;
+                std::size_t i = idx;
+                node_ptr c = join(slice(t, 0, i), from_string(std::string_view(&value, 1)));
+                lb->root = join(c, slice(t, i + 1, t->length - i - 1));
+                return *this;
+            }
+
+            // 한 글자를 읽을 때는 펼치지 않고 트리를 따라 내려간다
+            operator char() {
+                return char_at(lb->root.get(), idx);
+            }
+        };
+
+        temporary_proxy operator [](int idx) {
+            return temporary_proxy(this, idx);
+        }
+
+        Label& operator +=(const Label& other) {
+            root = join(root, other.root);
+            return *this;
+        }
+        friend Label operator +(const Label& a, const Label& b) { return Label(join(a.root, b.root)); }
+
+        // 공유하는 부분 문자열. 원래 Label의 chunk를 그대로 가리킨다
+        Label substr(std::size_t pos, std::size_t n) const {
+            // std::string::substr와 같이 pos가 size()를 넘으면 예외
+            if (pos > size()) {
+                throw std::out_of_range("rope::Label::substr");
+            }
+            n = std::min(n, size() - pos);
+            return Label(slice(root, pos, n));
+        }
+
+        std::size_t size() const noexcept { return root ? root->length : 0; }
+        unsigned depth() const noexcept { return height(root); }
+
+        std::string_view view() const {
+            if (!root) {
+                return {};
+            }
+            const node* leaf = contiguous();
+            return {leaf->text->text.get() + leaf->offset, leaf->length};
+        }
+
+        // 부분 문자열 leaf는 끝에 '\0'이 없을 수 있으므로 그때도 펼친다
+        const char* c_str() const {
+            if (!root) {
+                return "";
+            }
+            const node* leaf = contiguous();
+            if (leaf->offset + leaf->length != leaf->text->size) {
+                root = flatten(root);
+                leaf = root.get();
+            }
+            return leaf->text->text.get() + leaf->offset;
+        }
+
+        void print() const {
+            std::cout << c_str() << " ref: " << (root ? root->use_count() : 0) << std::endl;
+        }
+    };
+}
+
+static void basic() {
+    rope::Label lb1("hello");
+    rope::Label lb2 = lb1;
+    lb1.print(); // hello ref: 2
+
+    char c = lb1[0];
+    std::cout << c << std::endl; // h
+
+    lb1[0] = 'A'; // lb2가 보는 트리는 그대로 있다
+    lb1.print(); // Aello ref: 1
+    lb2.print(); // hello ref: 1
+
+    // 이어 붙이기와 부분 문자열은 chunk를 복사하지 않는다 (small_leaf 보다 긴 조각)
+    rope::Label big(std::string(200, 'x'));
+    rope::Label joined = big + rope::Label(std::string(200, 'y')) + big;
+    std::cout << joined.size() << ", " << joined.depth() << std::endl; // 600, 2
+    rope::Label sub = joined.substr(150, 300); // x 50개 + y 200개 + x 50개
+    std::cout << sub[0] << sub[50] << sub[299] << ", " << sub.depth() << std::endl; // xyx, 2
+    std::cout << sub.view().substr(45, 10) << ", " << sub.depth() << std::endl; // xxxxxyyyyy, 0 (처음 view()에서 펼쳤다)
+}
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+// label_interning.cpp에도 같은 이름의 class가 있으므로 이 파일 안에서만 보이게 한다
+namespace {
+    // exams.cpp의 Label과 같은 방식(new char[] + strcpy + new int). 이어 붙일 때도 전체를 새 버퍼로 복사한다
+    class copying_label {
+        char* text;
+        std::size_t size;
+        int* ref;
+    public:
+        copying_label(const char* s, std::size_t n) : text(new char[n + 1]), size(n), ref(new int(1)) {
+            std::memcpy(text, s, n);
+            text[n] = '\0';
+        }
+        copying_label(const copying_label&) = delete;
+        ~copying_label() {
+            delete ref;
+            delete[] text;
+        }
+
+        copying_label& operator +=(std::string_view s) {
+            char* t = new char[size + s.size() + 1];
+            std::memcpy(t, text, size);
+            std::memcpy(t + size, s.data(), s.size());
+            t[size + s.size()] = '\0';
+            delete[] text;
+            text = t;
+            size += s.size();
+            return *this;
+        }
+        copying_label substr(std::size_t pos, std::size_t n) const { return copying_label(text + pos, std::min(n, size - pos)); }
+
+        std::size_t length() const noexcept { return size; }
+        char operator [](std::size_t idx) const noexcept { return text[idx]; }
+    };
+}
+
+// 10byte 조각을 이어 붙여서 1MB Label을 만들고, 임의의 위치에서 짧은(256byte 이하) / 긴(64KB 이하) 부분 문자열을 substrs개씩 꺼낸다
+// copying label은 이어 붙일 때마다 전체를 복사하므로 build가 수십초 걸린다
+static void benchmark(std::size_t target = 1 << 20, std::size_t fragment = 10, std::size_t substrs = 200'000) {
+    using clock = std::chrono::steady_clock;
+    using std::chrono::milliseconds;
+    std::vector<std::string> fragments;
+    for (int i = 0; i < 1000; ++i) {
+        std::string f = std::to_string(i * 2654435761u);
+        f.resize(fragment, '-');
+        fragments.push_back(f);
+    }
+
+    auto run = [&](const char* name, auto make, auto append, auto sub) {
+        auto start = clock::now();
+        auto label = make();
+        std::size_t size = 0;
+        for (std::size_t i = 0; size < target; ++i, size += fragment) {
+            append(label, fragments[i % fragments.size()]);
+        }
+        std::cout << name << " build: " << std::chrono::duration_cast<milliseconds>(clock::now() - start).count() << "ms";
+
+        for (std::size_t max_substr : {std::size_t(256), std::size_t(64 * 1024)}) {
+            std::mt19937_64 gen(42);
+            long long sum = 0;
+            auto begin = clock::now();
+            for (std::size_t i = 0; i < substrs; ++i) {
+                std::size_t pos = gen() % size;
+                std::size_t n = gen() % max_substr + 1;
+                auto s = sub(label, pos, n);
+                sum += s[0]; // 부분 문자열을 사용해서 최적화로 사라지지 않도록
+            }
+            std::cout << ", substr(~" << max_substr << "): "
+                      << std::chrono::duration_cast<milliseconds>(clock::now() - begin).count() << "ms (" << sum << ")";
+        }
+        std::cout << std::endl;
+    };
+
+    run("copying label", [] { return copying_label("", 0); },
+        [](copying_label& lb, const std::string& f) { lb += f; },
+        [](const copying_label& lb, std::size_t pos, std::size_t n) { return lb.substr(pos, n); });
+    run("std::string", [] { return std::string(); },
+        [](std::string& s, const std::string& f) { s += f; },
+        [](const std::string& s, std::size_t pos, std::size_t n) { return s.substr(pos, n); });
+    run("rope::Label", [] { return rope::Label(); },
+        [](rope::Label& lb, const std::string& f) { lb += rope::Label(std::string_view(f)); },
+        [](rope::Label& lb, std::size_t pos, std::size_t n) { return lb.substr(pos, n); });
+
+    // 트리로 만든 Label은 처음 연속된 메모리가 필요할 때 한번 펼친다
+    rope::Label lb;
+    for (std::size_t i = 0; i * fragment < target; ++i) {
+        lb += rope::Label(std::string_view(fragments[i % fragments.size()]));
+    }
+    std::cout << "rope::Label depth: " << lb.depth();
+    auto start = clock::now();
+    std::size_t len = std::strlen(lb.c_str());
+    auto flattened = clock::now();
+    len += std::strlen(lb.c_str());
+    std::cout << ", first c_str: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(flattened - start).count() << "us, second c_str: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - flattened).count() << "us ("
+              << len << ")" << std::endl;
+}
+
+void rope_label() {
+    basic();
+    benchmark();
+}
@@ -0,0 +1,321 @@
+/*
+small_vector
+- 대부분의 list는 원소가 8개 미만인데, std::vector는 원소가 하나만 있어도 heap에 할당한다
+- small_vector<T, N>은 N개까지는 객체 안의 버퍼에 넣고, 넘치면 heap으로 옮긴다 (small buffer optimization)
+- allocator와 data 포인터를 compressed_pair로 묶는다. std::allocator는 empty class 이므로 (empty_class2() 참고) 공간을 차지하지 않는다
+- heap으로 옮길 때는 relocation(move 생성 + 원래 객체 소멸)을 한다. trivially relocatable 타입은 memcpy 한번으로 끝낸다
+- 원소 복사가 필요 없으므로 unique_ptr 같은 move-only 타입도 넣을 수 있다
+*/
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "compressed_pair.hpp"
+
+// memcpy로 옮긴 뒤 원래 객체의 소멸자를 부르지 않아도 되는 타입
+// trivially copyable이면 당연히 가능하고, unique_ptr 처럼 포인터 하나만 갖는 타입은 직접 특수화해서 알려준다
+template<typename T>
+struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+template<typename T>
+constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+template<typename T>
+constexpr bool is_nothrow_relocatable_v = is_trivially_relocatable_v<T> || std::is_nothrow_move_constructible_v<T>;
+
+// from의 n개 원소를 to로 옮긴다. 성공하면 from의 원소는 소멸된 상태가 된다
+// move가 예외를 던질 수 있는 타입은 std::vector처럼 move_if_noexcept로 복사한다
+// 중간에 예외가 나면 to에 만든 원소만 지우고 from은 그대로 둔다 (strong guarantee)
+template<typename T>
+void relocate_n(T* from, std::size_t n, T* to) noexcept(is_nothrow_relocatable_v<T>) {
+    if constexpr (is_trivially_relocatable_v<T>) {
+        if (n) {
+            std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(T));
+        }
+    } else if constexpr (std::is_nothrow_move_constructible_v<T>) {
+        for (std::size_t i = 0; i < n; ++i) {
+            ::new(static_cast<void*>(to + i)) T(std::move(from[i]));
+            from[i].~T();
+        }
+    } else {
+        std::size_t i = 0;
+        try {
+            for (; i < n; ++i) {
+                ::new(static_cast<void*>(to + i)) T(std::move_if_noexcept(from[i]));
+            }
+        } catch (...) {
+            std::destroy_n(to, i);
+            throw;
+        }
+        std::destroy_n(from, n);
+    }
+}
+
+template<typename T, std::size_t N, typename Alloc = std::allocator<T>>
+class small_vector {
+    static_assert(N > 0, "N must be greater than 0");
+    using alloc_traits = std::allocator_traits<Alloc>;
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using allocator_type = Alloc;
+    using pointer = T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    // compressed_pair는 인자 2개짜리 생성자가 겹칠 수 있으므로 allocator도 직접 넘긴다
+    small_vector() : cpair(one_and_variadic_arg_t{}, Alloc(), inline_data()) {}
+    explicit small_vector(const Alloc& alloc) : cpair(one_and_variadic_arg_t{}, alloc, inline_data()) {}
+
+    small_vector(std::initializer_list<T> init) requires std::is_copy_constructible_v<T> : small_vector() {
+        reserve(init.size());
+        for (const T& v : init) {
+            emplace_back(v);
+        }
+    }
+
+    small_vector(const small_vector& sv) requires std::is_copy_constructible_v<T>
+    : cpair(one_and_variadic_arg_t{}, alloc_traits::select_on_container_copy_construction(sv.get_allocator()), inline_data()) {
+        reserve(sv.size());
+        for (const T& v : sv) {
+            emplace_back(v);
+        }
+    }
+
+    // 상대가 heap을 쓰고 있으면 포인터만 가져오고, 내부 버퍼를 쓰고 있으면 원소를 하나씩 옮긴다
+    small_vector(small_vector&& sv) noexcept(is_nothrow_relocatable_v<T>)
+    : cpair(one_and_variadic_arg_t{}, std::move(sv.get_allocator()), inline_data()) {
+        take(sv);
+    }
+
+    small_vector& operator =(small_vector&& sv) noexcept(is_nothrow_relocatable_v<T>) {
+        if (this != std::addressof(sv)) {
+            clear();
+            release_heap();
+            get_allocator() = std::move(sv.get_allocator());
+            take(sv);
+        }
+        return *this;
+    }
+
+    small_vector& operator =(const small_vector& sv) requires std::is_copy_constructible_v<T> {
+        if (this != std::addressof(sv)) {
+            small_vector tmp(sv);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    ~small_vector() {
+        clear();
+        release_heap();
+    }
+
+    template<typename ... Args>
+    T& emplace_back(Args&& ... args) {
+        if (sz == cap) {
+            // 새 공간에 새 원소를 먼저 만들고 기존 원소를 옮긴다. args가 기존 원소를 참조하고 있을 수 있기 때문
+            size_type new_cap = cap * 2;
+            T* p = alloc_traits::allocate(get_allocator(), new_cap);
+            try {
+                alloc_traits::construct(get_allocator(), p + sz, std::forward<Args>(args)...);
+            } catch (...) {
+                alloc_traits::deallocate(get_allocator(), p, new_cap);
+                throw;
+            }
+            try {
+                relocate_n(data(), sz, p);
+            } catch (...) {
+                alloc_traits::destroy(get_allocator(), p + sz);
+                alloc_traits::deallocate(get_allocator(), p, new_cap);
+                throw;
+            }
+            release_heap();
+            cpair.getSecond() = p;
+            cap = new_cap;
+        } else {
+            alloc_traits::construct(get_allocator(), data() + sz, std::forward<Args>(args)...);
+        }
+        return data()[sz++];
+    }
+
+    void push_back(const T& v) { emplace_back(v); }
+    void push_back(T&& v) { emplace_back(std::move(v)); }
+
+    void pop_back() noexcept {
+        alloc_traits::destroy(get_allocator(), data() + --sz);
+    }
+
+    void clear() noexcept {
+        std::destroy_n(data(), sz);
+        sz = 0;
+    }
+
+    void reserve(size_type n) {
+        if (n <= cap) {
+            return;
+        }
+        T* p = alloc_traits::allocate(get_allocator(), n);
+        try {
+            relocate_n(data(), sz, p);
+        } catch (...) {
+            alloc_traits::deallocate(get_allocator(), p, n);
+            throw;
+        }
+        release_heap();
+        cpair.getSecond() = p;
+        cap = n;
+    }
+
+    T& operator [](size_type idx) noexcept { return data()[idx]; }
+    const T& operator [](size_type idx) const noexcept { return data()[idx]; }
+    T& back() noexcept { return data()[sz - 1]; }
+
+    T* data() noexcept { return cpair.getSecond(); }
+    const T* data() const noexcept { return cpair.getSecond(); }
+    size_type size() const noexcept { return sz; }
+    size_type capacity() const noexcept { return cap; }
+    bool empty() const noexcept { return sz == 0; }
+    bool is_inline() const noexcept { return cpair.getSecond() == inline_data(); }
+
+    iterator begin() noexcept { return data(); }
+    iterator end() noexcept { return data() + sz; }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator end() const noexcept { return data() + sz; }
+
+    Alloc& get_allocator() noexcept { return cpair.getFirst(); }
+    const Alloc& get_allocator() const noexcept { return cpair.getFirst(); }
+
+private:
+    T* inline_data() noexcept { return reinterpret_cast<T*>(buf); }
+    const T* inline_data() const noexcept { return reinterpret_cast<const T*>(buf); }
+
+    void release_heap() noexcept {
+        if (!is_inline()) {
+            alloc_traits::deallocate(get_allocator(), data(), cap);
+            cpair.getSecond() = inline_data();
+            cap = N;
+        }
+    }
+
+    // 이 객체는 비어 있고 내부 버퍼를 가리키고 있어야 한다
+    void take(small_vector& sv) noexcept(is_nothrow_relocatable_v<T>) {
+        if (sv.is_inline()) {
+            relocate_n(sv.data(), sv.sz, inline_data());
+        } else {
+            cpair.getSecond() = std::exchange(sv.cpair.getSecond(), sv.inline_data());
+            cap = std::exchange(sv.cap, N);
+        }
+        sz = std::exchange(sv.sz, 0);
+    }
+
+    // allocator는 empty class인 경우가 많으므로 first에 둔다
+    compressed_pair<Alloc, T*> cpair;
+    size_type sz = 0;
+    size_type cap = N;
+    alignas(T) unsigned char buf[N * sizeof(T)];
+};
+
+#include <iostream>
+#include <string>
+#include "unique_ptr.hpp"
+
+struct Item {
+    int value;
+    explicit Item(int value) : value(value) {}
+};
+
+using item_ptr = using_compressed_pair::unique_ptr<Item, using_compressed_pair::quiet_delete<Item>>;
+
+// unique_ptr는 포인터 하나와 empty 삭제자만 가지므로 memcpy로 옮겨도 된다
+template<>
+struct is_trivially_relocatable<item_ptr> : std::true_type {};
+
+static void basic() {
+    small_vector<int, 4> v = {1, 2, 3};
+    std::cout << std::boolalpha;
+    std::cout << v.size() << ", " << v.capacity() << ", " << v.is_inline() << std::endl; // 3, 4, true
+    v.push_back(4);
+    v.push_back(5); // 넘쳐서 heap으로 옮긴다
+    std::cout << v.size() << ", " << v.capacity() << ", " << v.is_inline() << std::endl; // 5, 8, false
+
+    // data 포인터 + size + capacity + 버퍼(4 * 4byte). allocator는 공간을 차지하지 않는다
+    std::cout << sizeof(small_vector<int, 4>) << std::endl; // 40
+}
+
+static void move_only() {
+    small_vector<item_ptr, 2> v;
+    v.emplace_back(new Item(1));
+    v.emplace_back(new Item(2));
+    v.push_back(item_ptr(new Item(3))); // memcpy로 relocation
+    for (auto& p : v) {
+        std::cout << p->value << ", ";
+    }
+    std::cout << std::endl;
+
+    // small_vector<item_ptr, 2> v2 = v; // error. 원소를 복사할 수 없다
+    small_vector<item_ptr, 2> v2 = std::move(v); // heap 포인터만 가져온다
+    std::cout << v.size() << ", " << v2.size() << std::endl; // 0, 3
+
+    // std::string은 trivially relocatable로 표시하지 않았으므로 move 생성 + 소멸로 옮긴다
+    small_vector<std::string, 1> s;
+    s.emplace_back("hello");
+    s.emplace_back("world");
+    small_vector<std::string, 1> s2 = std::move(s);
+    std::cout << s2[0] << " " << s2[1] << std::endl; // hello world
+}
+
+// exams.cpp의 Label 처럼 복사 생성자만 있는 타입. move는 복사로 대신되고 noexcept가 아니다
+struct Name {
+    std::string text;
+    Name(const char* s) : text(s) {}
+    Name(const Name& n) : text(n.text) { std::cout << "copy " << text << std::endl; }
+};
+
+static void copy_only() {
+    static_assert(!std::is_nothrow_move_constructible_v<Name>);
+    small_vector<Name, 1> v;
+    v.emplace_back("a");
+    // 넘칠 때 원래 원소를 복사한다. 복사 중에 예외가 나도 v는 그대로 남는다 (strong guarantee)
+    v.emplace_back("b"); // copy a
+    std::cout << v[0].text << v[1].text << std::endl; // ab
+}
+
+#include <chrono>
+#include <vector>
+
+// 원소 0 ~ 8개짜리 list를 n번 만들고 순회하는 시간을 std::vector와 비교
+static void benchmark(std::size_t n = 10'000'000) {
+    using clock = std::chrono::steady_clock;
+    auto run = [&](const char* name, auto make) {
+        auto start = clock::now();
+        long long sum = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            auto list = make();
+            std::size_t count = i % 9;
+            for (std::size_t k = 0; k < count; ++k) {
+                list.push_back(static_cast<int>(i + k));
+            }
+            for (int e : list) {
+                sum += e;
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start).count();
+        std::cout << name << ": " << elapsed << "ms (" << sum << ")" << std::endl;
+    };
+
+    run("std::vector<int>", [] { return std::vector<int>(); });
+    run("std::vector<int> + reserve(8)", [] { std::vector<int> v; v.reserve(8); return v; });
+    run("small_vector<int, 8>", [] { return small_vector<int, 8>(); });
+    run("small_vector<int, 4>", [] { return small_vector<int, 4>(); });
+}
+
+void making_small_vector() {
+    basic();
+    move_only();
+    copy_only();
+    benchmark();
+}
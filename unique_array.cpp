@@ -0,0 +1,269 @@
+/*
+unique_array
+- unique_ptr<T[], D>는 배열의 길이를 기억하지 못하고, int로 indexing 하며, new T[n]() 처럼 value 초기화를 피할 수 없다
+- (deleter, pointer, size)를 compressed_pair로 묶어서 길이를 기억하는 소유 배열을 만든다
+- 초기화 방식은 tag dispatching으로 선택한다 (new(std::nothrow) 처럼)
+- over-aligned 할당(SIMD용)을 지원한다
+- begin()/end()/data()/size()를 제공해서 contiguous_range가 되도록 한다
+*/
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include "compressed_pair.hpp"
+
+// 초기화 방식을 나타내는 tag type
+// adopt_lock_t와 마찬가지로 unique_array a(10, {}); 처럼 쓰는 것을 막기 위해 explicit 생성자를 둔다
+struct default_init_t {
+    explicit default_init_t() = default;
+};
+constexpr default_init_t default_init; // T가 class면 디폴트 생성자 호출, int 같은 타입은 쓰레기 값 (new T[n] 과 동일)
+
+struct no_init_t {
+    explicit no_init_t() = default;
+};
+constexpr no_init_t no_init; // 메모리만 할당하고 아무것도 하지 않음. trivial 타입만 가능
+
+// 삭제자는 원소 개수를 알아야 소멸자를 호출할 수 있고, 정렬 값을 알아야 할당 해제를 할 수 있다
+// 따라서 (pointer, size)를 받는다. 멤버 데이터가 없으므로 empty class
+template<typename T, std::size_t Align = alignof(T)>
+struct array_delete {
+    array_delete() = default;
+    void operator ()(T* p, std::size_t n) const noexcept {
+        std::destroy_n(p, n);
+        ::operator delete(p, std::align_val_t{Align});
+    }
+};
+
+template<typename T, std::size_t Align = alignof(T), typename D = array_delete<T, Align>>
+class unique_array {
+    static_assert(Align >= alignof(T) && (Align & (Align - 1)) == 0, "Align must be a power of two and at least alignof(T)");
+public:
+    using pointer = T*;
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using size_type = std::size_t;
+    using deleter_type = D;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    unique_array() : cpair(zero_and_variadic_arg_t{}, nullptr, 0) {}
+    // unique_array a(0)이 size_type 생성자와 겹치지 않도록 정확히 nullptr_t일 때만 받는다
+    template<std::same_as<std::nullptr_t> N>
+    unique_array(N) : cpair(zero_and_variadic_arg_t{}, nullptr, 0) {}
+
+    // value 초기화. new T[n]() 와 동일. int라면 0으로 채운다
+    explicit unique_array(size_type n) : cpair(zero_and_variadic_arg_t{}, allocate(n), n) {
+        construct([](T* p, size_type n) { std::uninitialized_value_construct_n(p, n); });
+    }
+    // default 초기화. new T[n] 과 동일
+    unique_array(size_type n, default_init_t) : cpair(zero_and_variadic_arg_t{}, allocate(n), n) {
+        construct([](T* p, size_type n) { std::uninitialized_default_construct_n(p, n); });
+    }
+    // 초기화하지 않음. 생성자/소멸자가 trivial 해야 destroy_n이 아무일도 하지 않으므로 안전하다
+    unique_array(size_type n, no_init_t) requires std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>
+    : cpair(zero_and_variadic_arg_t{}, allocate(n), n) {}
+
+    // 직접 할당한 메모리를 넘기는 경우. 삭제자는 (p, n)으로 호출된다
+    // 기본 삭제자(array_delete)를 쓰면 p는 ::operator new(n * sizeof(T), std::align_val_t{Align})로 할당하고
+    // n개의 원소를 생성해 둔 메모리여야 한다. new T[n]으로 만든 포인터는 delete[]를 하는 삭제자를 직접 넘겨야 한다
+    unique_array(pointer p, size_type n) : cpair(zero_and_variadic_arg_t{}, p, n) {}
+    unique_array(pointer p, size_type n, const D& d) : cpair(one_and_variadic_arg_t{}, d, p, n) {}
+    unique_array(pointer p, size_type n, D&& d) : cpair(one_and_variadic_arg_t{}, std::move(d), p, n) {}
+
+    ~unique_array() { if (get()) get_deleter()(get(), size()); }
+
+    unique_array(const unique_array&) = delete;
+    unique_array& operator =(const unique_array&) = delete;
+
+    unique_array(unique_array&& ua) noexcept
+    : cpair(one_and_variadic_arg_t{}, std::move(ua.get_deleter()), ua.get(), ua.size()) {
+        ua.cpair.getSecond().getFirst() = nullptr;
+        ua.cpair.getSecond().getSecond() = 0;
+    }
+
+    unique_array& operator =(unique_array&& ua) noexcept {
+        if (this != std::addressof(ua)) {
+            size_type n = ua.size();
+            reset(ua.release(), n);
+            get_deleter() = std::move(ua.get_deleter());
+        }
+        return *this;
+    }
+
+    // 길이를 알고 있으므로 size_t로 indexing 한다
+    T& operator [](size_type idx) { return get()[idx]; }
+    const T& operator [](size_type idx) const { return get()[idx]; }
+
+    pointer get() const noexcept { return cpair.getSecond().getFirst(); }
+    // const unique_array도 contiguous_range가 되려면 data()와 begin()의 타입이 같아야 한다
+    T* data() noexcept { return get(); }
+    const T* data() const noexcept { return get(); }
+    size_type size() const noexcept { return cpair.getSecond().getSecond(); }
+    bool empty() const noexcept { return size() == 0; }
+
+    // contiguous_range가 되려면 begin()이 contiguous_iterator(T*)를 리턴하면 된다
+    iterator begin() noexcept { return get(); }
+    iterator end() noexcept { return get() + size(); }
+    const_iterator begin() const noexcept { return get(); }
+    const_iterator end() const noexcept { return get() + size(); }
+
+    D& get_deleter() noexcept { return cpair.getFirst(); }
+    const D& get_deleter() const noexcept { return cpair.getFirst(); }
+    explicit operator bool() const noexcept { return get() != nullptr; }
+
+    // 소유권을 포기한다. 길이가 필요하면 release() 전에 size()를 읽어두자
+    pointer release() noexcept {
+        cpair.getSecond().getSecond() = 0;
+        return std::exchange(cpair.getSecond().getFirst(), nullptr);
+    }
+
+    void reset(pointer p = nullptr, size_type n = 0) noexcept {
+        pointer old = std::exchange(cpair.getSecond().getFirst(), p);
+        size_type old_n = std::exchange(cpair.getSecond().getSecond(), n);
+        if (old) {
+            get_deleter()(old, old_n);
+        }
+    }
+
+    void swap(unique_array& ua) noexcept {
+        std::swap(cpair.getFirst(), ua.cpair.getFirst());
+        std::swap(cpair.getSecond().getFirst(), ua.cpair.getSecond().getFirst());
+        std::swap(cpair.getSecond().getSecond(), ua.cpair.getSecond().getSecond());
+    }
+
+private:
+    static pointer allocate(size_type n) {
+        // n * sizeof(T)가 넘치면 작은 버퍼에 n개를 생성하게 된다 (new T[n]과 동일하게 처리)
+        if (n > SIZE_MAX / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<pointer>(::operator new(n * sizeof(T), std::align_val_t{Align}));
+    }
+
+    // 원소 생성 중 예외가 발생하면 메모리를 돌려놓는다. 이미 생성된 원소는 uninitialized_*_n이 정리해 준다
+    template<typename F>
+    void construct(F f) {
+        try {
+            f(get(), size());
+        } catch (...) {
+            ::operator delete(get(), std::align_val_t{Align});
+            throw;
+        }
+    }
+
+    // deleter는 empty class인 경우가 많으므로 first에 두고, (pointer, size)는 second에 둔다
+    compressed_pair<D, compressed_pair<pointer, size_type>> cpair;
+};
+
+static void basic() {
+    unique_array<int> a1(10); // 0으로 채워짐
+    unique_array<int> a2(10, default_init); // 쓰레기 값
+    unique_array<int> a3(10, no_init); // 할당만
+    // unique_array<std::string> a4(10, no_init); // error. trivial 타입이 아니다
+    // unique_array<int> a5(10, {}); // error. explicit 생성자 때문에 tag를 명시해야 한다
+
+    for (std::size_t i = 0; i < a2.size(); ++i) {
+        a2[i] = static_cast<int>(i);
+    }
+    std::cout << a1[3] << ", " << a2[3] << ", " << a3.size() << std::endl;
+
+    unique_array<int> a6 = std::move(a2);
+    std::cout << a2.size() << ", " << a6.size() << std::endl; // 0, 10
+
+    // 직접 할당해서 넘길 때는 array_delete와 같은 방식(정렬된 ::operator new + 원소 생성)으로 만든다
+    int* raw = static_cast<int*>(::operator new(4 * sizeof(int), std::align_val_t{alignof(int)}));
+    std::uninitialized_fill_n(raw, 4, 7);
+    unique_array<int> adopted(raw, 4);
+    // new int[4]는 delete[]로 지워야 하므로 삭제자를 함께 넘긴다
+    auto array_new_delete = [](int* p, std::size_t) { delete[] p; };
+    unique_array<int, alignof(int), decltype(array_new_delete)> adopted2(new int[4]{1, 2, 3, 4}, 4, array_new_delete);
+    std::cout << adopted[3] << ", " << adopted2[3] << std::endl; // 7, 4
+
+    unique_array<int> a7(0); // 길이 0. nullptr_t 생성자와 겹치지 않는다
+    unique_array<int> a8 = nullptr;
+    std::cout << a7.size() << ", " << a8.size() << std::endl; // 0, 0
+    try {
+        unique_array<int> a9(SIZE_MAX / 2);
+    } catch (const std::bad_array_new_length&) {
+        std::cout << "bad_array_new_length" << std::endl;
+    }
+
+    // deleter는 empty class 이므로 pointer + size 만큼의 크기만 차지한다
+    std::cout << sizeof(unique_array<int>) << std::endl; // 16
+}
+
+static void over_aligned() {
+    // SIMD(AVX-512) load/store를 위해 64byte 정렬
+    unique_array<float, 64> a(100);
+    std::cout << (reinterpret_cast<std::uintptr_t>(a.data()) % 64) << std::endl; // 0
+}
+
+static void contiguous() {
+    unique_array<int> a(10);
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        a[i] = static_cast<int>(i + 1);
+    }
+
+    static_assert(std::ranges::contiguous_range<unique_array<int>>);
+    static_assert(std::ranges::sized_range<unique_array<int>>);
+    static_assert(std::ranges::contiguous_range<const unique_array<int>>);
+
+    // lvalue는 ref_view로 감싸지므로 view adaptor에 바로 넘길 수 있다
+    for (auto e : a | std::views::reverse | std::views::drop(3)) {
+        std::cout << e << ", ";
+    }
+    std::cout << std::endl;
+
+    // contiguous_range 이므로 span으로도 바로 변환된다
+    std::span<int> s(a);
+    const unique_array<int>& ca = a;
+    std::span<const int> cs(ca);
+    std::cout << s.size() << ", " << cs.size() << std::endl; // 10, 10
+}
+
+#include <chrono>
+#include <cstddef>
+
+// 1GB 버퍼 할당 시간을 zero-fill 여부에 따라 비교
+// no_init은 페이지를 건드리지 않으므로 실제 물리 메모리는 처음 쓸 때 할당된다
+static void benchmark(std::size_t bytes = std::size_t(1) << 30) {
+    using clock = std::chrono::steady_clock;
+    auto measure = [](const char* name, auto f) {
+        auto start = clock::now();
+        f();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+        std::cout << name << ": " << elapsed.count() << "us" << std::endl;
+    };
+
+    measure("new std::byte[n]()", [&] {
+        std::byte* p = new std::byte[bytes]();
+        delete[] p;
+    });
+    measure("unique_array value init", [&] {
+        unique_array<std::byte> a(bytes);
+    });
+    measure("unique_array default init", [&] {
+        unique_array<std::byte> a(bytes, default_init);
+    });
+    measure("unique_array no init", [&] {
+        unique_array<std::byte> a(bytes, no_init);
+    });
+    measure("unique_array<std::byte, 64> no init", [&] {
+        unique_array<std::byte, 64> a(bytes, no_init);
+    });
+}
+
+void making_unique_array() {
+    basic();
+    over_aligned();
+    contiguous();
+    benchmark();
+}